@@ -0,0 +1,261 @@
+// Times FinanceDB's public methods against a synthetic dataset and writes the
+// results as JSON so runs can be compared over time.
+//
+// Usage: finance_bench [--rows N] [--years Y] [--iterations K]
+//                      [--dir PATH] [--json PATH]
+//
+// N expenses (default 10000) are spread evenly over the last Y years
+// (default 3) of month tables, the current month included. Every method is
+// called K times (default 200) and reported as p50/p99/mean latency plus heap
+// allocations per call. Analytic methods are measured twice: straight from
+// SQLite and from the columnar snapshot.
+
+#include "FinanceDB.h"
+#include <sqlite3.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// --- Allocation counting ---
+
+static std::atomic<size_t> allocCount{0};
+static std::atomic<size_t> allocBytes{0};
+
+void* operator new(size_t size) {
+    allocCount.fetch_add(1, std::memory_order_relaxed);
+    allocBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+// --- Results ---
+
+struct BenchResult {
+    std::string name;
+    std::string mode;
+    size_t iterations;
+    double p50Us;
+    double p99Us;
+    double meanUs;
+    double allocsPerOp;
+    double bytesPerOp;
+};
+
+static BenchResult measure(const std::string& name, const std::string& mode, size_t iterations,
+                           const std::function<void(size_t)>& op) {
+    std::vector<double> samples;
+    samples.reserve(iterations);
+    size_t allocsBefore = allocCount.load(), bytesBefore = allocBytes.load();
+    for (size_t i = 0; i < iterations; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        op(i);
+        auto end = std::chrono::steady_clock::now();
+        samples.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+    }
+    // The samples vector was reserved up front, so these are the op's own allocations
+    size_t allocs = allocCount.load() - allocsBefore, bytes = allocBytes.load() - bytesBefore;
+
+    std::sort(samples.begin(), samples.end());
+    double sum = 0.0;
+    for (double s : samples) sum += s;
+    auto percentile = [&samples](double p) {
+        size_t idx = static_cast<size_t>(p * (samples.size() - 1) + 0.5);
+        return samples[idx];
+    };
+    return {name, mode, iterations, percentile(0.50), percentile(0.99), sum / iterations,
+            static_cast<double>(allocs) / iterations, static_cast<double>(bytes) / iterations};
+}
+
+// --- Synthetic data ---
+
+static void exec(sqlite3* db, const std::string& sql) {
+    char* err = nullptr;
+    if (sqlite3_exec(db, sql.c_str(), 0, 0, &err) != SQLITE_OK) {
+        std::cerr << "SQL error: " << err << std::endl;
+        sqlite3_free(err);
+    }
+}
+
+// Writes Main.db/Detailed.db in the layout FinanceDB expects, with `rows`
+// expenses spread over the last `years` years of month tables
+static void seed(const std::string& dir, size_t rows, int years) {
+    static const char* items[] = {"Groceries", "Coffee", "Bus Fare", "Rent", "Lunch", "Dinner", "Movies",
+                                  "Fuel", "Electricity", "Internet", "Gym", "Books", "Pharmacy", "Taxi"};
+    static const char* categories[] = {"Food", "Travel", "Housing", "Utilities", "Fun", "Health", "Education"};
+    static const char* modes[] = {"Cash", "Card", "Upi", "Bank Transfer"};
+
+    sqlite3* mainDb;
+    sqlite3_open((dir + "/Main.db").c_str(), &mainDb);
+    exec(mainDb, "CREATE TABLE IF NOT EXISTS Categories (id INTEGER PRIMARY KEY AUTOINCREMENT, name TEXT UNIQUE NOT NULL);");
+    exec(mainDb, "CREATE TABLE IF NOT EXISTS ModeOfPayment (id INTEGER PRIMARY KEY AUTOINCREMENT, name TEXT UNIQUE NOT NULL);");
+    for (const char* c : categories) exec(mainDb, std::string("INSERT OR IGNORE INTO Categories (name) VALUES ('") + c + "');");
+    for (const char* m : modes) exec(mainDb, std::string("INSERT OR IGNORE INTO ModeOfPayment (name) VALUES ('") + m + "');");
+    sqlite3_close(mainDb);
+
+    sqlite3* db;
+    sqlite3_open((dir + "/Detailed.db").c_str(), &db);
+    exec(db, "PRAGMA synchronous = OFF;");
+    exec(db, "PRAGMA journal_mode = MEMORY;");
+
+    std::time_t now = std::time(nullptr);
+    std::tm tm_local;
+    localtime_r(&now, &tm_local);
+    int month = tm_local.tm_mon + 1, year = tm_local.tm_year + 1900;
+    const int monthCount = years * 12;
+
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> priceDist(1.0, 300.0);
+    std::uniform_int_distribution<int> dayDist(1, 28);
+    size_t seq = 0;
+    for (int m = 0; m < monthCount; ++m) {
+        char table[32];
+        std::snprintf(table, sizeof(table), "expenses_%02d_%04d", month, year);
+        exec(db, std::string("CREATE TABLE IF NOT EXISTS ") + table + " (day_month_year TEXT PRIMARY KEY, SpentOn TEXT NOT NULL, "
+                 "Price REAL NOT NULL, CategoryId INTEGER, ModeOfPaymentId INTEGER, Priority INTEGER DEFAULT 0);");
+
+        size_t perMonth = rows / monthCount + (static_cast<size_t>(m) < rows % monthCount ? 1 : 0);
+        exec(db, "BEGIN;");
+        sqlite3_stmt* stmt;
+        sqlite3_prepare_v2(db, (std::string("INSERT INTO ") + table + " VALUES (?, ?, ?, ?, ?, 0);").c_str(), -1, &stmt, 0);
+        for (size_t i = 0; i < perMonth; ++i) {
+            char key[48];
+            std::snprintf(key, sizeof(key), "%02d_%02d_%04d_%zu", dayDist(rng), month, year, seq++);
+            sqlite3_bind_text(stmt, 1, key, -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(stmt, 2, items[rng() % (sizeof(items) / sizeof(items[0]))], -1, SQLITE_STATIC);
+            sqlite3_bind_double(stmt, 3, static_cast<int>(priceDist(rng) * 100) / 100.0);
+            sqlite3_bind_int(stmt, 4, 1 + static_cast<int>(rng() % (sizeof(categories) / sizeof(categories[0]))));
+            sqlite3_bind_int(stmt, 5, 1 + static_cast<int>(rng() % (sizeof(modes) / sizeof(modes[0]))));
+            sqlite3_step(stmt);
+            sqlite3_reset(stmt);
+        }
+        sqlite3_finalize(stmt);
+        exec(db, "COMMIT;");
+
+        if (--month == 0) {
+            month = 12;
+            --year;
+        }
+    }
+    sqlite3_close(db);
+}
+
+// --- Main ---
+
+int main(int argc, char** argv) {
+    size_t rows = 10000;
+    int years = 3;
+    size_t iterations = 200;
+    std::string dir = "finance_bench_data";
+    std::string jsonPath = "finance_bench.json";
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--rows") rows = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (arg == "--years") years = std::max(1, std::atoi(argv[i + 1]));
+        else if (arg == "--iterations") iterations = std::max<size_t>(1, std::strtoull(argv[i + 1], nullptr, 10));
+        else if (arg == "--dir") dir = argv[i + 1];
+        else if (arg == "--json") jsonPath = argv[i + 1];
+        else {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::remove_all(dir, ec);
+    if (!std::filesystem::create_directories(dir, ec)) {
+        std::cerr << "Cannot prepare " << dir << ": " << ec.message() << std::endl;
+        return 1;
+    }
+
+    std::cout << "Seeding " << rows << " expenses over " << years << " years into " << dir << "..." << std::endl;
+    auto seedStart = std::chrono::steady_clock::now();
+    seed(dir, rows, years);
+    double seedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - seedStart).count();
+
+    std::vector<BenchResult> results;
+    std::time_t now = std::time(nullptr);
+    std::tm tm_local;
+    localtime_r(&now, &tm_local);
+    int year = tm_local.tm_year + 1900;
+
+    results.push_back(measure("FinanceDB::FinanceDB", "sqlite", 1, [&](size_t) {
+        FinanceDB db(dir + "/Main.db", dir + "/Detailed.db");
+    }));
+
+    FinanceDB db(dir + "/Main.db", dir + "/Detailed.db");
+    auto analyticMethods = [&](const std::string& mode) {
+        results.push_back(measure("calcTotalSpent", mode, iterations, [&](size_t) { db.calcTotalSpent(); }));
+        results.push_back(measure("calcPriority", mode, iterations, [&](size_t) { db.calcPriority(); }));
+        results.push_back(measure("getMonthlyTotalsForYear", mode, iterations, [&](size_t) { db.getMonthlyTotalsForYear(year); }));
+    };
+
+    analyticMethods("sqlite");
+    results.push_back(measure("calcSortByPrice", "sqlite", iterations, [&](size_t i) { db.calcSortByPrice(i % 2 == 0); }));
+    results.push_back(measure("getRangeOfDate", "sqlite", iterations, [&](size_t) { db.getRangeOfDate("01_00_0000", "15_99_9999"); }));
+    results.push_back(measure("getAllCategories", "sqlite", iterations, [&](size_t) { db.getAllCategories(); }));
+
+    results.push_back(measure("enableAnalyticsSnapshot", "snapshot", 1, [&](size_t) { db.enableAnalyticsSnapshot(); }));
+    analyticMethods("snapshot");
+
+    // Write paths run last so the read measurements see the seeded data only
+    std::vector<int> targetIds;
+    results.push_back(measure("addExpense", "snapshot", iterations, [&](size_t i) {
+        db.addExpense(i % 2 ? "Coffee" : "Bench Item", 3.5 + i, std::string("Food"), std::nullopt, std::string("Cash"));
+    }));
+    for (const auto& e : db.calcSortByPrice(false)) {
+        if (targetIds.size() >= iterations) break;
+        targetIds.push_back(e.id);
+    }
+    results.push_back(measure("updatePriority", "snapshot", iterations, [&](size_t) { db.updatePriority("Coffee"); }));
+    // Edits and deletes need rows of the current month to work on
+    if (targetIds.empty()) {
+        std::cerr << "No rows in the current month; skipping update and delete measurements" << std::endl;
+    } else {
+        results.push_back(measure("updateSelected2", "snapshot", iterations, [&](size_t i) {
+            db.updateSelected2(targetIds[i % targetIds.size()], std::nullopt, 20.0 + i, std::nullopt);
+        }));
+        results.push_back(measure("updateSelected3", "snapshot", iterations, [&](size_t i) {
+            db.updateSelected3(targetIds[i % targetIds.size()], std::nullopt, 10.0 + i, std::string("Fun"), std::nullopt, std::nullopt, std::nullopt);
+        }));
+        results.push_back(measure("deleteSelected", "snapshot", std::min(iterations, targetIds.size()), [&](size_t i) { db.deleteSelected(targetIds[i]); }));
+    }
+
+    // Report
+    std::cout << "\n" << std::left << std::setw(26) << "method" << std::setw(10) << "mode" << std::right << std::setw(8) << "iters"
+              << std::setw(12) << "p50 (us)" << std::setw(12) << "p99 (us)" << std::setw(12) << "allocs/op" << std::setw(14) << "bytes/op" << "\n";
+    for (const auto& r : results) {
+        std::cout << std::left << std::setw(26) << r.name << std::setw(10) << r.mode << std::right << std::setw(8) << r.iterations
+                  << std::fixed << std::setprecision(1) << std::setw(12) << r.p50Us << std::setw(12) << r.p99Us
+                  << std::setw(12) << r.allocsPerOp << std::setw(14) << r.bytesPerOp << "\n";
+    }
+
+    std::ofstream json(jsonPath);
+    json << "{\n  \"rows\": " << rows << ",\n  \"years\": " << years << ",\n  \"iterations\": " << iterations
+         << ",\n  \"seed_ms\": " << seedMs << ",\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        json << "    {\"name\": \"" << r.name << "\", \"mode\": \"" << r.mode << "\", \"iterations\": " << r.iterations
+             << ", \"p50_us\": " << r.p50Us << ", \"p99_us\": " << r.p99Us << ", \"mean_us\": " << r.meanUs
+             << ", \"allocs_per_op\": " << r.allocsPerOp << ", \"bytes_per_op\": " << r.bytesPerOp << "}"
+             << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    json << "  ]\n}\n";
+    std::cout << "\nResults written to " << jsonPath << std::endl;
+    return 0;
+}
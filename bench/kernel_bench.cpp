@@ -0,0 +1,162 @@
+// Compares the aggregation kernels (scalar, SSE2, AVX2) against SQLite
+// computing the same aggregates with SUM(Price), and checks every vector
+// kernel against the scalar reference.
+//
+// Usage: kernel_bench [rows]   (default 1000000)
+
+#include "AggregateKernels.h"
+#include <sqlite3.h>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Best-of-N wall time in microseconds; the last result is stored in `out`
+static double timeBest(int runs, const std::function<double()>& fn, double& out) {
+    double best = 1e300;
+    for (int r = 0; r < runs; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        out = fn();
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::micro>(end - start).count());
+    }
+    return best;
+}
+
+static double sqlScalar(sqlite3* db, const std::string& sql) {
+    sqlite3_stmt* stmt;
+    double result = 0.0;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, 0) == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW) {
+        result = sqlite3_column_double(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return result;
+}
+
+static bool close(double a, double b) {
+    return std::fabs(a - b) <= 1e-9 * std::max(1.0, std::max(std::fabs(a), std::fabs(b)));
+}
+
+int main(int argc, char** argv) {
+    size_t rows = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    const int runs = 5;
+
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> priceDist(1.0, 500.0);
+    std::uniform_int_distribution<int> yearDist(2020, 2026), monthDist(1, 12), codeDist(0, 30);
+
+    std::vector<double> prices(rows);
+    std::vector<int32_t> months(rows);
+    std::vector<uint16_t> codes(rows);
+    for (size_t i = 0; i < rows; ++i) {
+        prices[i] = std::round(priceDist(rng) * 100.0) / 100.0;
+        months[i] = yearDist(rng) * 100 + monthDist(rng);
+        codes[i] = static_cast<uint16_t>(codeDist(rng));
+    }
+
+    // Same data in an in-memory SQLite table
+    sqlite3* db;
+    sqlite3_open(":memory:", &db);
+    sqlite3_exec(db, "CREATE TABLE expenses (Month INTEGER, CategoryId INTEGER, Price REAL);", 0, 0, 0);
+    sqlite3_exec(db, "BEGIN;", 0, 0, 0);
+    sqlite3_stmt* insert;
+    sqlite3_prepare_v2(db, "INSERT INTO expenses VALUES (?, ?, ?);", -1, &insert, 0);
+    for (size_t i = 0; i < rows; ++i) {
+        sqlite3_bind_int(insert, 1, months[i]);
+        sqlite3_bind_int(insert, 2, codes[i]);
+        sqlite3_bind_double(insert, 3, prices[i]);
+        sqlite3_step(insert);
+        sqlite3_reset(insert);
+    }
+    sqlite3_finalize(insert);
+    sqlite3_exec(db, "COMMIT;", 0, 0, 0);
+
+    const int32_t month = 202506;
+    const uint16_t code = 7;
+    std::vector<const AggregateKernels*> kernelSets = {&scalarKernels(), sse2Kernels(), avx2Kernels()};
+    std::cout << "rows: " << rows << ", active kernels: " << activeKernels().name << "\n\n";
+    std::cout << std::left << std::setw(22) << "aggregate" << std::setw(10) << "impl" << std::right
+              << std::setw(14) << "best (us)" << std::setw(20) << "result" << "\n";
+
+    bool ok = true;
+    auto report = [&](const std::string& aggregate, const std::string& impl, double us, double result, double reference) {
+        bool match = close(result, reference);
+        ok = ok && match;
+        std::cout << std::left << std::setw(22) << aggregate << std::setw(10) << impl << std::right << std::setw(14)
+                  << std::fixed << std::setprecision(1) << us << std::setw(20) << std::setprecision(2) << result
+                  << (match ? "" : "  MISMATCH") << "\n";
+    };
+
+    double reference, result, us;
+
+    // sum
+    reference = scalarKernels().sum(prices.data(), rows);
+    us = timeBest(runs, [&] { return sqlScalar(db, "SELECT SUM(Price) FROM expenses;"); }, result);
+    report("sum", "sqlite", us, result, reference);
+    for (const AggregateKernels* k : kernelSets) {
+        if (!k) continue;
+        us = timeBest(runs, [&] { return k->sum(prices.data(), rows); }, result);
+        report("sum", k->name, us, result, reference);
+    }
+
+    // sum for one month
+    reference = scalarKernels().sumInRange(prices.data(), months.data(), rows, month, month);
+    us = timeBest(runs, [&] { return sqlScalar(db, "SELECT TOTAL(Price) FROM expenses WHERE Month = " + std::to_string(month) + ";"); }, result);
+    report("sum month", "sqlite", us, result, reference);
+    for (const AggregateKernels* k : kernelSets) {
+        if (!k) continue;
+        us = timeBest(runs, [&] { return k->sumInRange(prices.data(), months.data(), rows, month, month); }, result);
+        report("sum month", k->name, us, result, reference);
+    }
+
+    // sum for one category
+    reference = scalarKernels().sumForCode(prices.data(), codes.data(), rows, code);
+    us = timeBest(runs, [&] { return sqlScalar(db, "SELECT TOTAL(Price) FROM expenses WHERE CategoryId = " + std::to_string(code) + ";"); }, result);
+    report("sum category", "sqlite", us, result, reference);
+    for (const AggregateKernels* k : kernelSets) {
+        if (!k) continue;
+        us = timeBest(runs, [&] { return k->sumForCode(prices.data(), codes.data(), rows, code); }, result);
+        report("sum category", k->name, us, result, reference);
+    }
+
+    // max (min is computed in the same pass)
+    reference = scalarKernels().minMax(prices.data(), rows).max;
+    us = timeBest(runs, [&] { return sqlScalar(db, "SELECT MAX(Price) FROM expenses;"); }, result);
+    report("max", "sqlite", us, result, reference);
+    for (const AggregateKernels* k : kernelSets) {
+        if (!k) continue;
+        us = timeBest(runs, [&] { return k->minMax(prices.data(), rows).max; }, result);
+        report("min/max", k->name, us, result, reference);
+    }
+
+    // yearly histogram, reported as the total of the 12 buckets
+    std::vector<double> buckets(12);
+    auto histogramTotal = [&](const AggregateKernels& k) {
+        std::fill(buckets.begin(), buckets.end(), 0.0);
+        k.histogram(prices.data(), months.data(), rows, 202501, buckets.size(), buckets.data());
+        double total = 0.0;
+        for (double b : buckets) total += b;
+        return total;
+    };
+    reference = histogramTotal(scalarKernels());
+    us = timeBest(runs, [&] { return sqlScalar(db, "SELECT TOTAL(t) FROM (SELECT SUM(Price) AS t FROM expenses WHERE Month BETWEEN 202501 AND 202512 GROUP BY Month);"); }, result);
+    report("year histogram", "sqlite", us, result, reference);
+    for (const AggregateKernels* k : kernelSets) {
+        if (!k) continue;
+        us = timeBest(runs, [&] { return histogramTotal(*k); }, result);
+        report("year histogram", k->name, us, result, reference);
+    }
+
+    sqlite3_close(db);
+    if (!ok) {
+        std::cerr << "\nKernel results differ from the scalar reference." << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,355 @@
+// Load generator for a running expense server. Each worker holds one
+// keep-alive connection, logs in, then loops over a weighted mix of the
+// operations the frontend performs: the dashboard fan-out, adding an expense,
+// fetching the yearly graph and logging in again. Latency is recorded per
+// route in an HDR-style log-linear histogram.
+//
+// Usage: loadgen [--host 127.0.0.1] [--port 5000] [--connections 8]
+//                [--duration 10] [--user loadgen] [--password loadgen123]
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// --- Latency histogram ---
+
+// Log-linear histogram over microseconds: values below 64 are exact, larger
+// ones are grouped by power of two and each power is split into 64 linear
+// sub-buckets, so any recorded value is reported within ~1.6% (1/64) below
+// its true value.
+class LatencyHistogram {
+private:
+    static const int SUB_BUCKET_BITS = 6;
+    static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static const int MAGNITUDES = 40;
+    std::vector<uint64_t> counts = std::vector<uint64_t>(MAGNITUDES * SUB_BUCKETS, 0);
+    uint64_t total = 0;
+    uint64_t maxValue = 0;
+
+    // Magnitude m holds [64 << m, 128 << m) in steps of 1 << m, so all 64
+    // sub-buckets of every power of two are used
+    static size_t indexFor(uint64_t value) {
+        if (value < SUB_BUCKETS) return value;
+        int magnitude = 63 - __builtin_clzll(value) - SUB_BUCKET_BITS;
+        size_t sub = (value >> magnitude) - SUB_BUCKETS;
+        return std::min<size_t>(SUB_BUCKETS + magnitude * SUB_BUCKETS + sub, MAGNITUDES * SUB_BUCKETS - 1);
+    }
+    static uint64_t valueFor(size_t index) {
+        if (index < SUB_BUCKETS) return index;
+        size_t magnitude = (index - SUB_BUCKETS) / SUB_BUCKETS;
+        size_t sub = (index - SUB_BUCKETS) % SUB_BUCKETS;
+        return static_cast<uint64_t>(SUB_BUCKETS + sub) << magnitude;
+    }
+
+public:
+    void record(uint64_t us) {
+        counts[indexFor(us)]++;
+        total++;
+        maxValue = std::max(maxValue, us);
+    }
+    void merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < counts.size(); ++i) counts[i] += other.counts[i];
+        total += other.total;
+        maxValue = std::max(maxValue, other.maxValue);
+    }
+    uint64_t count() const { return total; }
+    uint64_t max() const { return maxValue; }
+    uint64_t percentile(double p) const {
+        if (total == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(std::ceil(p / 100.0 * total));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts.size(); ++i) {
+            seen += counts[i];
+            if (seen >= std::max<uint64_t>(rank, 1)) return std::min(valueFor(i), maxValue);
+        }
+        return maxValue;
+    }
+};
+
+// --- Minimal HTTP/1.1 keep-alive client ---
+
+struct HttpResponse {
+    int status = 0;
+    std::string headers;
+    std::string body;
+};
+
+class HttpConnection {
+private:
+    std::string host;
+    int port;
+    int fd = -1;
+    std::string buffer;
+
+    bool connectSocket() {
+        fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) return false;
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        inet_pton(AF_INET, host.c_str(), &addr.sin_addr);
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            ::close(fd);
+            fd = -1;
+            return false;
+        }
+        buffer.clear();
+        return true;
+    }
+
+    bool readMore() {
+        char chunk[16384];
+        ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0) return false;
+        buffer.append(chunk, n);
+        return true;
+    }
+
+public:
+    HttpConnection(std::string host, int port) : host(std::move(host)), port(port) {}
+    ~HttpConnection() {
+        if (fd >= 0) ::close(fd);
+    }
+
+    std::string cookie;
+    uint64_t reconnects = 0;
+
+    // Sends one request and reads the response; reconnects once if the server
+    // closed the idle connection
+    bool request(const std::string& method, const std::string& path, const std::string& body, HttpResponse& res) {
+        for (int attempt = 0; attempt < 2; ++attempt) {
+            if (fd < 0) {
+                if (!connectSocket()) return false;
+                if (attempt > 0 || reconnects > 0) reconnects++;
+            }
+            std::string req = method + " " + path + " HTTP/1.1\r\nHost: " + host + "\r\nConnection: keep-alive\r\n";
+            if (!cookie.empty()) req += "Cookie: session=" + cookie + "\r\n";
+            if (!body.empty()) req += "Content-Type: application/json\r\nContent-Length: " + std::to_string(body.size()) + "\r\n";
+            req += "\r\n" + body;
+            if (::send(fd, req.data(), req.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(req.size()) || !readResponse(res)) {
+                ::close(fd);
+                fd = -1;
+                continue;
+            }
+            if (res.headers.find("Connection: close") != std::string::npos) {
+                ::close(fd);
+                fd = -1;
+            }
+            return true;
+        }
+        return false;
+    }
+
+    bool readResponse(HttpResponse& res) {
+        size_t headerEnd;
+        while ((headerEnd = buffer.find("\r\n\r\n")) == std::string::npos) {
+            if (!readMore()) return false;
+        }
+        res.headers = buffer.substr(0, headerEnd);
+        res.status = std::atoi(res.headers.c_str() + 9);
+        size_t length = 0;
+        size_t pos = res.headers.find("Content-Length: ");
+        if (pos == std::string::npos) pos = res.headers.find("content-length: ");
+        if (pos != std::string::npos) length = std::strtoull(res.headers.c_str() + pos + 16, nullptr, 10);
+        while (buffer.size() < headerEnd + 4 + length) {
+            if (!readMore()) return false;
+        }
+        res.body = buffer.substr(headerEnd + 4, length);
+        buffer.erase(0, headerEnd + 4 + length);
+        return true;
+    }
+};
+
+// --- Workload ---
+
+struct RouteStats {
+    LatencyHistogram latency;
+    uint64_t errors = 0;
+};
+
+struct WorkerStats {
+    std::map<std::string, RouteStats> routes;
+    uint64_t failures = 0;
+    uint64_t reconnects = 0;
+};
+
+struct Options {
+    std::string host = "127.0.0.1";
+    int port = 5000;
+    int connections = 8;
+    int duration = 10;
+    std::string user = "loadgen";
+    std::string password = "loadgen123";
+};
+
+static std::string currentMonthYear() {
+    std::time_t now = std::time(nullptr);
+    std::tm tm_local;
+    localtime_r(&now, &tm_local);
+    char buf[16];
+    std::strftime(buf, sizeof(buf), "%m_%Y", &tm_local);
+    return buf;
+}
+
+static bool login(HttpConnection& conn, const Options& opt, WorkerStats& stats, const std::string& route) {
+    HttpResponse res;
+    std::string body = "{\"username\": \"" + opt.user + "\", \"password\": \"" + opt.password + "\"}";
+    auto start = std::chrono::steady_clock::now();
+    bool ok = conn.request("POST", "/login", body, res);
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    RouteStats& rs = stats.routes[route];
+    rs.latency.record(us);
+    if (!ok || res.status != 200) {
+        rs.errors++;
+        return false;
+    }
+    size_t pos = res.headers.find("session=");
+    if (pos == std::string::npos) return false;
+    size_t end = res.headers.find_first_of(";\r", pos);
+    conn.cookie = res.headers.substr(pos + 8, end - pos - 8);
+    return true;
+}
+
+static void worker(const Options& opt, std::chrono::steady_clock::time_point deadline, unsigned seed, WorkerStats& stats) {
+    HttpConnection conn(opt.host, opt.port);
+    if (!login(conn, opt, stats, "POST /login")) {
+        stats.failures++;
+        return;
+    }
+
+    std::mt19937 rng(seed);
+    const std::string month = currentMonthYear();
+    const char* items[] = {"Coffee", "Groceries", "Bus Fare", "Lunch", "Movies"};
+    auto timed = [&](const std::string& method, const std::string& path, const std::string& route, const std::string& body) {
+        HttpResponse res;
+        auto start = std::chrono::steady_clock::now();
+        bool ok = conn.request(method, path, body, res);
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        RouteStats& rs = stats.routes[route];
+        rs.latency.record(us);
+        if (!ok) {
+            rs.errors++;
+            stats.failures++;
+        } else if (res.status >= 400) {
+            rs.errors++;
+        }
+    };
+
+    // Weights: dashboard 60%, add expense 25%, graph 5%, re-login 10%
+    std::discrete_distribution<int> mix({60, 25, 5, 10});
+    while (std::chrono::steady_clock::now() < deadline) {
+        switch (mix(rng)) {
+        case 0:
+            timed("GET", "/me", "GET /me", "");
+            timed("GET", "/categories", "GET /categories", "");
+            timed("GET", "/mode_of_payment", "GET /mode_of_payment", "");
+            timed("GET", "/summary", "GET /summary", "");
+            timed("GET", "/expenses/" + month, "GET /expenses/<month>", "");
+            timed("GET", "/highest", "GET /highest", "");
+            timed("GET", "/total_spent", "GET /total_spent", "");
+            break;
+        case 1: {
+            char body[128];
+            std::snprintf(body, sizeof(body), "{\"spentOn\": \"%s\", \"price\": %.2f}", items[rng() % 5], 1.0 + rng() % 5000 / 100.0);
+            timed("POST", "/expense", "POST /expense", body);
+            break;
+        }
+        case 2:
+            timed("GET", "/graph/yearly", "GET /graph/yearly", "");
+            break;
+        case 3:
+            login(conn, opt, stats, "POST /login");
+            break;
+        }
+    }
+    stats.reconnects = conn.reconnects;
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--host") opt.host = argv[i + 1];
+        else if (arg == "--port") opt.port = std::atoi(argv[i + 1]);
+        else if (arg == "--connections") opt.connections = std::max(1, std::atoi(argv[i + 1]));
+        else if (arg == "--duration") opt.duration = std::max(1, std::atoi(argv[i + 1]));
+        else if (arg == "--user") opt.user = argv[i + 1];
+        else if (arg == "--password") opt.password = argv[i + 1];
+        else {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    // Make sure the load-test account exists; "already taken" is fine
+    {
+        HttpConnection conn(opt.host, opt.port);
+        HttpResponse res;
+        std::string body = "{\"username\": \"" + opt.user + "\", \"password\": \"" + opt.password + "\"}";
+        if (!conn.request("POST", "/register", body, res)) {
+            std::cerr << "Cannot reach " << opt.host << ":" << opt.port << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "Running " << opt.connections << " connections for " << opt.duration << "s against "
+              << opt.host << ":" << opt.port << "..." << std::endl;
+    std::vector<WorkerStats> stats(opt.connections);
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::seconds(opt.duration);
+    for (int i = 0; i < opt.connections; ++i) {
+        threads.emplace_back(worker, std::cref(opt), deadline, 1234u + i, std::ref(stats[i]));
+    }
+    for (auto& t : threads) t.join();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::map<std::string, RouteStats> routes;
+    LatencyHistogram overall;
+    uint64_t failures = 0, reconnects = 0, errors = 0;
+    for (const auto& s : stats) {
+        failures += s.failures;
+        reconnects += s.reconnects;
+        for (const auto& r : s.routes) {
+            routes[r.first].latency.merge(r.second.latency);
+            routes[r.first].errors += r.second.errors;
+            overall.merge(r.second.latency);
+            errors += r.second.errors;
+        }
+    }
+
+    std::cout << "\n" << std::left << std::setw(24) << "route" << std::right << std::setw(9) << "requests" << std::setw(8) << "errors"
+              << std::setw(10) << "req/s" << std::setw(10) << "p50 us" << std::setw(10) << "p90 us" << std::setw(10) << "p99 us"
+              << std::setw(10) << "p99.9 us" << std::setw(10) << "max us" << "\n";
+    auto row = [&](const std::string& name, const LatencyHistogram& h, uint64_t errs) {
+        std::cout << std::left << std::setw(24) << name << std::right << std::setw(9) << h.count() << std::setw(8) << errs
+                  << std::setw(10) << std::fixed << std::setprecision(0) << h.count() / elapsed << std::setw(10) << h.percentile(50)
+                  << std::setw(10) << h.percentile(90) << std::setw(10) << h.percentile(99) << std::setw(10) << h.percentile(99.9)
+                  << std::setw(10) << h.max() << "\n";
+    };
+    for (const auto& r : routes) row(r.first, r.second.latency, r.second.errors);
+    row("TOTAL", overall, errors);
+    std::cout << "\nelapsed " << std::setprecision(2) << elapsed << "s, transport failures " << failures
+              << ", reconnects " << reconnects << std::endl;
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,37 @@
+#ifndef AGGREGATEKERNELS_H
+#define AGGREGATEKERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+struct MinMax {
+  double min;
+  double max;
+};
+
+// Aggregation kernels over contiguous price columns. Every instruction set
+// fills in the same table; activeKernels() picks the widest one the CPU
+// supports the first time it is called. The scalar table is the reference the
+// vector versions are checked against (results may differ in the last bits
+// because the additions happen in a different order).
+struct AggregateKernels {
+  const char *name;
+
+  double (*sum)(const double *values, size_t n);
+  // {+inf, -inf} for n == 0
+  MinMax (*minMax)(const double *values, size_t n);
+  // Sum of values[i] where lo <= keys[i] <= hi (keys are YYYYMM or YYYYMMDD)
+  double (*sumInRange)(const double *values, const int32_t *keys, size_t n, int32_t lo, int32_t hi);
+  // Sum of values[i] where codes[i] == code (category / mode dictionary ids)
+  double (*sumForCode)(const double *values, const uint16_t *codes, size_t n, uint16_t code);
+  // out[k] += values[i] for every i where keys[i] - base == k < buckets
+  void (*histogram)(const double *values, const int32_t *keys, size_t n, int32_t base, size_t buckets, double *out);
+};
+
+const AggregateKernels &scalarKernels();
+// Null when the instruction set is not compiled in or not supported by the CPU
+const AggregateKernels *sse2Kernels();
+const AggregateKernels *avx2Kernels();
+const AggregateKernels &activeKernels();
+
+#endif // AGGREGATEKERNELS_H
@@ -0,0 +1,87 @@
+#ifndef BACKUP_H
+#define BACKUP_H
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <sqlite3.h>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Online backups through SQLite's backup API. A database is copied
+// BACKUP_STEP_PAGES pages per step with a short pause in between; the source
+// is locked only while a step runs, so a writer never waits for more than one
+// step. Writes made through the source connection during the copy are carried
+// into it, so every copy is a consistent image of its database.
+static const int BACKUP_STEP_PAGES = 128;
+static const int BACKUP_STEP_PAUSE_MS = 2;
+
+struct BackupStats {
+  std::string name; // file name in the snapshot, e.g. "Main.db"
+  bool ok = false;
+  std::string error;
+  long long pages = 0;
+  long long bytes = 0;
+  int steps = 0;
+  double seconds = 0.0;         // wall time, pauses included
+  double stallSeconds = 0.0;    // time spent inside steps, source locked
+  double maxStallSeconds = 0.0; // longest single step
+};
+
+// Copies schema `schema` of `source` (an attached database for anything but
+// "main") to the file at destPath, replacing it
+BackupStats backupDatabase(sqlite3 *source, const std::string &destPath, const std::string &name, const char *schema = "main");
+
+// Overwrites the database file destPath with a snapshot copy, after checking
+// the copy with PRAGMA quick_check. Meant for when the server is stopped.
+bool restoreDatabase(const std::string &snapshotPath, const std::string &destPath, std::string &error);
+
+struct SnapshotInfo {
+  std::string id; // directory name, local time YYYYMMDD-HHMMSS
+  long long bytes;
+};
+
+// Takes a snapshot into a new subdirectory of `directory` every interval and
+// keeps the newest `keep` of them. A snapshot is written under "<id>.partial"
+// and renamed once every file is copied, so a listed snapshot is complete.
+class BackupScheduler {
+public:
+  // Copies each database into the given, already created, directory
+  using SnapshotFn = std::function<std::vector<BackupStats>(const std::string &directory)>;
+
+private:
+  std::string directory;
+  size_t keep;
+  SnapshotFn snapshot;
+
+  std::mutex runMutex; // one snapshot at a time
+  mutable std::mutex mutex;
+  std::condition_variable wake;
+  bool stopping = false;
+  std::thread worker;
+  std::string lastId;
+  std::vector<BackupStats> last;
+
+  void prune();
+
+public:
+  BackupScheduler(std::string directory, size_t keep, SnapshotFn snapshot);
+  ~BackupScheduler();
+
+  // Starts the periodic snapshots; an interval of zero leaves them off
+  void start(std::chrono::minutes interval);
+  void stop();
+
+  // Takes a snapshot now; returns its id, empty if it failed
+  std::string snapshotNow();
+  // Complete snapshots, oldest first
+  std::vector<SnapshotInfo> list() const;
+  // Id and per-file stats of the most recent attempt
+  std::pair<std::string, std::vector<BackupStats>> lastRun() const;
+  const std::string &root() const { return directory; }
+};
+
+#endif // BACKUP_H
@@ -0,0 +1,92 @@
+#ifndef BUDGETALERTS_H
+#define BUDGETALERTS_H
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+enum class AlertLevel { Ok = 0, Warning = 1, Exceeded = 2 };
+
+// Which limit an alert is about
+enum class AlertRule { MonthLimit, CategoryLimit, ProjectedOverspend };
+
+struct BudgetAlert {
+  uint64_t id;
+  std::string time; // local, YYYY-MM-DD HH:MM:SS
+  AlertRule rule;
+  std::string subject; // month (MM_YYYY) or category name
+  AlertLevel level;
+  double spent; // for ProjectedOverspend, the projected month total
+  double limit;
+};
+
+// Budget rules for the current month, evaluated against running totals.
+// Every write reports its delta through record(), which touches only the
+// month rule, the projection and the rule of the expense's category, so the
+// cost per write is constant no matter how many expenses or rules exist.
+//
+// A rule raises an alert when it climbs a level (Ok -> Warning at
+// WARNING_FRACTION of the limit -> Exceeded); falling back, e.g. after a
+// delete, is silent and re-arms the rule. Alerts are kept in a bounded
+// in-memory log for polling and handed to listeners as they happen.
+class BudgetAlerts {
+public:
+  static constexpr double WARNING_FRACTION = 0.8;
+  static const size_t MAX_ALERTS = 256;
+
+private:
+  struct Rule {
+    std::string subject;
+    double limit = 0.0;
+    AlertLevel level = AlertLevel::Ok;
+  };
+
+  mutable std::mutex mutex;
+  double monthTotal = 0.0;
+  std::unordered_map<int, double> categoryTotals; // Categories.id -> spent
+  Rule monthRule;
+  Rule projectedRule;
+  std::unordered_map<int, Rule> categoryRules; // only categories with a limit
+  std::deque<BudgetAlert> alerts;
+  uint64_t nextId = 1;
+  std::vector<std::function<void(const BudgetAlert &)>> listeners;
+
+  // Caller holds the mutex; appends to `raised` if the rule climbed a level
+  void evaluate(Rule &rule, AlertRule kind, double spent, std::vector<BudgetAlert> &raised);
+  void evaluateMonth(std::vector<BudgetAlert> &raised);
+  void publish(const std::vector<BudgetAlert> &raised);
+
+public:
+  // Seeds the running totals (once, at startup) without raising alerts for
+  // limits that were already crossed before the server started
+  void load(const std::string &monthYear, double monthLimit, double spent,
+            const std::unordered_map<int, double> &spentByCategory,
+            const std::unordered_map<int, std::pair<std::string, double>> &categoryLimits);
+
+  // An expense of `amount` (negative to take one back) in `categoryId` (0
+  // for none) was written to the current month
+  void record(int categoryId, double amount);
+  // An expense changed from `oldAmount` in `oldCategoryId` to `amount` in
+  // `categoryId`; applied as one step so an edit can't re-raise an alert
+  void replace(int oldCategoryId, double oldAmount, int categoryId, double amount);
+  void setMonthLimit(double limit);
+  // A limit of 0 removes the rule
+  void setCategoryLimit(int categoryId, const std::string &name, double limit);
+
+  double spent() const;
+  double categorySpent(int categoryId) const;
+
+  // Alerts with an id greater than `afterId`, oldest first
+  std::vector<BudgetAlert> since(uint64_t afterId) const;
+  // Called, outside the lock, for every alert raised from now on
+  void subscribe(std::function<void(const BudgetAlert &)> listener);
+};
+
+const char *alertRuleName(AlertRule rule);
+const char *alertLevelName(AlertLevel level);
+
+#endif // BUDGETALERTS_H
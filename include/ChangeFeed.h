@@ -0,0 +1,45 @@
+#ifndef CHANGEFEED_H
+#define CHANGEFEED_H
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+// Fan-out of change events to live connections (one subscriber per open
+// socket, so a user with several devices gets one per device). Each event is
+// a JSON object, stamped with a sequence number so a client that reconnects
+// can ask for what it missed; the last HISTORY_SIZE events are kept for that.
+class ChangeFeed {
+public:
+  static const size_t HISTORY_SIZE = 512;
+  using Sink = std::function<void(const std::string &)>;
+
+private:
+  mutable std::mutex mutex;
+  uint64_t nextSeq = 1;
+  std::deque<std::pair<uint64_t, std::string>> history;
+  uint64_t nextSubscriber = 1;
+  std::map<uint64_t, Sink> subscribers;
+
+public:
+  // `fields` are the members after "seq" and "type", already JSON-encoded
+  // and without braces. Sinks are called under the feed's lock, so they must
+  // only queue the message (as a WebSocket send does), never block on it.
+  uint64_t publish(const std::string &type, const std::string &fields);
+
+  // Registers a sink and first replays the retained events after `sinceSeq`.
+  // If those are no longer all retained, a single "resync" event carrying the
+  // latest seq is sent instead, telling the client to reload. Returns a
+  // handle for unsubscribe.
+  uint64_t subscribe(Sink send, uint64_t sinceSeq = UINT64_MAX);
+  void unsubscribe(uint64_t handle);
+
+  size_t subscriberCount() const;
+  uint64_t lastSeq() const;
+};
+
+#endif // CHANGEFEED_H
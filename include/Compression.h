@@ -0,0 +1,51 @@
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// Content-Encodings the server can produce. Zstd is only available when the
+// build found libzstd (EXPENSE_HAVE_ZSTD).
+enum class ContentEncoding { Identity = 0, Deflate = 1, Gzip = 2, Zstd = 3 };
+
+// Bodies smaller than this go out uncompressed; the headers would eat most of
+// the savings
+const size_t COMPRESSION_MIN_BYTES = 1024;
+
+// Picks the best encoding allowed by an Accept-Encoding header (zstd, then
+// gzip, then deflate among those with the highest q; q=0 excludes)
+ContentEncoding negotiateEncoding(const std::string &acceptEncoding);
+// Token for the Content-Encoding header ("" for identity)
+const char *encodingName(ContentEncoding encoding);
+// Whether a Content-Type is worth compressing (text, JSON, SVG)
+bool isCompressible(const std::string &contentType);
+// Level for a Content-Type: dynamic JSON trades ratio for speed, rarely
+// produced SVG graphs compress harder
+int compressionLevel(const std::string &contentType, ContentEncoding encoding);
+// Compresses `body` into `out`; false if the encoding is unsupported or fails
+bool compressBody(const std::string &body, ContentEncoding encoding, int level, std::string &out);
+
+// Lazily built encoded copies of an immutable body, for responses served from
+// a cache: each encoding is compressed at most once, on first request, and
+// shared by every later reader.
+class PrecompressedBody {
+private:
+  static const int ENCODING_COUNT = 4;
+  std::string body;
+  std::string contentType;
+  mutable std::once_flag once[ENCODING_COUNT];
+  mutable std::string encoded[ENCODING_COUNT];
+  mutable bool usable[ENCODING_COUNT] = {};
+
+public:
+  PrecompressedBody(std::string body, std::string contentType);
+
+  const std::string &identity() const { return body; }
+  // Encoded body, or nullptr when the body is under COMPRESSION_MIN_BYTES,
+  // the encoding is identity, or compression failed
+  const std::string *get(ContentEncoding encoding) const;
+};
+
+#endif // COMPRESSION_H
@@ -0,0 +1,130 @@
+#ifndef EXPENSECOLUMNS_H
+#define EXPENSECOLUMNS_H
+
+#include "PriceRanks.h"
+#include "QuantileSketch.h"
+#include "SpendWindows.h"
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Per-item aggregate for one month, as returned by ExpenseColumns
+struct ItemAggregate {
+  std::string spent_on;
+  double total;
+  int count;
+};
+
+// Running price statistics for one item over a window of months; p50/p90
+// are estimates from QuantileSketch
+struct ItemStats {
+  std::string spent_on;
+  int count = 0;
+  double total = 0.0;
+  double min = 0.0;
+  double max = 0.0;
+  double p50 = 0.0;
+  double p90 = 0.0;
+};
+
+// Nearest-rank price quantiles of one month: prices[i] answers quantiles[i]
+// of the request. Empty when the month has no expenses.
+struct PriceDistribution {
+  size_t count = 0;
+  std::vector<double> prices;
+};
+
+// Struct-of-arrays copy of every expense row, kept in sync by FinanceDB's
+// write path so dashboard aggregates run over contiguous arrays instead of
+// going back to SQLite. Rows are identified by (month, rowid) where month is
+// the YYYYMM of the expenses_MM_YYYY table they live in. A row costs 30 bytes
+// of column data, its share of a node in its month's price tree and its slot in
+// the key index.
+class ExpenseColumns {
+private:
+  std::vector<int32_t> months;   // YYYYMM of the owning table
+  std::vector<int32_t> dates;    // YYYYMMDD parsed from day_month_year, 0 if unknown
+  std::vector<double> prices;
+  std::vector<uint16_t> items;   // code into itemNames
+  std::vector<uint16_t> categories; // Categories.id, 0 when unset
+  std::vector<uint16_t> modes;   // ModeOfPayment.id, 0 when unset
+  std::vector<int64_t> keys;     // (month << 32) | rowid, parallel to the columns
+
+  std::unordered_map<int64_t, size_t> positions; // key -> row index
+  std::vector<std::string> itemNames;
+  std::unordered_map<std::string, uint16_t> itemCodes;
+  bool overflowed = false; // a dictionary ran out of 16-bit codes
+  // Each month's prices in an order-statistic tree, so inserts, deletes and
+  // any rank are O(log n) however large the month grows
+  std::unordered_map<int32_t, PriceRanks> sortedPrices;
+
+  // Per month and item code: the bucket's rows, their sum, min, max and a
+  // price sketch, kept up to date on every write so /highest and item
+  // drill-downs are lookups. Count and sum stay exact when a row leaves; a
+  // sketch can't forget a value, so min, max and the sketch are marked stale
+  // instead and rebuilt from the bucket's own rows on the next read.
+  struct ItemBucket {
+    std::vector<int64_t> rows; // keys of the rows in this bucket
+    double total = 0.0;
+    double min = 0.0;
+    double max = 0.0;
+    QuantileSketch sketch;
+    bool stale = false;
+  };
+  mutable std::unordered_map<int32_t, std::unordered_map<uint16_t, ItemBucket>> itemBuckets;
+  // Readers hold the shared lock, so rebuilding a stale bucket is serialized here
+  mutable std::mutex bucketMutex;
+
+  // Daily totals by expense date for the rolling-window figures; has its own lock
+  SpendWindows spend;
+
+  mutable std::shared_mutex mutex;
+
+  static int64_t makeKey(int month, int rowid) { return (static_cast<int64_t>(month) << 32) | static_cast<uint32_t>(rowid); }
+  uint16_t internItem(const std::string &spentOn);
+  static uint16_t narrowId(int id, bool &overflowed);
+  void addSortedPrice(int32_t month, double price);
+  void eraseSortedPrice(int32_t month, double price);
+  void addToBucket(int32_t month, uint16_t item, int64_t key, double price);
+  void removeFromBucket(int32_t month, uint16_t item, int64_t key, double price);
+  // Caller holds the shared lock and bucketMutex
+  void refreshBucket(ItemBucket &bucket) const;
+
+public:
+  void clear();
+
+  // Inserts a row, or overwrites it if (month, rowid) is already present
+  void upsert(int month, int rowid, const std::string &dayMonthYear, const std::string &spentOn,
+              double price, int categoryId, int modeOfPaymentId);
+  // Applies a partial update; a category/mode id of 0 clears the value
+  void update(int month, int rowid, const std::optional<std::string> &dayMonthYear,
+              const std::optional<std::string> &spentOn, const std::optional<double> &price,
+              const std::optional<int> &categoryId, const std::optional<int> &modeOfPaymentId);
+  void remove(int month, int rowid);
+
+  // False once more than 65535 distinct items or ids were seen; callers must
+  // fall back to SQLite from then on
+  bool usable() const;
+  size_t size() const;
+  size_t memoryBytes() const;
+
+  double totalForMonth(int month) const;
+  // Spend dated within the last `days` days (see SpendWindows)
+  double spendInLastDays(int days) { return spend.total(days); }
+  // Totals for January..December of `year`, by owning table
+  std::array<double, 12> monthlyTotals(int year) const;
+  // Count and total per item for one month, most purchased first
+  std::vector<ItemAggregate> itemAggregates(int month) const;
+  // Statistics for one item over months fromMonth..toMonth (YYYYMM,
+  // inclusive); count 0 when it wasn't bought in that window
+  ItemStats itemStats(const std::string &spentOn, int fromMonth, int toMonth) const;
+  // Prices at the given fractions (0, 1] of one month, O(log n) per quantile
+  PriceDistribution priceQuantiles(int month, const std::vector<double> &quantiles) const;
+};
+
+#endif // EXPENSECOLUMNS_H
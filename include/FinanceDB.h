@@ -1,7 +1,18 @@
 #ifndef FINANCEDB_H
 #define FINANCEDB_H
 
+#include "Backup.h"
+#include "BudgetAlerts.h"
+#include "ExpenseColumns.h"
+#include "QueryProfiler.h"
+#include "ReadPool.h"
+#include "RefDataCache.h"
+#include "SuggestIndex.h"
+#include <atomic>
+#include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <sqlite3.h>
 #include <string>
@@ -16,27 +27,197 @@ struct MonthlySummary {
   std::string condition;
 };
 
+// Rolling spend and the current month's budget, for the burn-rate view
+struct SpendOverview {
+  double last7Days;
+  double last30Days;
+  double last90Days;
+  double monthToDate;
+  double limit;    // LimitAmount of the current month, 0 when not set
+  int dayOfMonth;  // today, 1-based
+  int daysInMonth;
+};
+
+// A per-category spending limit for the current month
+struct CategoryLimit {
+  std::string category;
+  double limit;
+  double spent; // this month so far
+};
+
 // Struct to hold a record from a detailed expense table
 struct ExpenseRecord {
   int id; // Corresponds to SQLite rowid
   std::string day_month_year;
   std::string spent_on;
   double price;
-  std::string category;
-  std::string mode_of_payment;
+  int category_id;        // Categories.id, 0 when unset
+  int mode_of_payment_id; // ModeOfPayment.id, 0 when unset
   int priority;
 };
 
+// What a write did to the current month, for the live change feed
+enum class ChangeKind { Insert, Update, Delete };
+struct ExpenseChange {
+  ChangeKind kind;
+  ExpenseRecord record; // only id is set for Delete
+  double monthTotal;    // the current month's total after the write
+};
+
+// One entry of the change log. Inserts and updates carry the row as written
+// (priority excluded: it is derived and not logged); deletes only the id.
+struct ChangeLogEntry {
+  long long seq;
+  std::string op;     // "insert", "update" or "delete"
+  int month;          // YYYYMM of the month table
+  ExpenseRecord record;
+  std::string at;     // UTC, YYYY-MM-DD HH:MM:SS
+};
+
+struct ChangeLogPage {
+  std::vector<ChangeLogEntry> entries;
+  long long latest;  // newest seq in the log, 0 when empty
+  bool truncated;    // entries after `since` were dropped; the client must resync
+};
+
+// A write made offline, replayed through applySync. `ts` (the client's clock,
+// ms since the epoch) stamps every field the mutation sets. Each field is
+// settled on its own against the stamp of its last write: the newer stamp
+// wins, ties go to the larger client id.
+struct SyncMutation {
+  std::string mutationId; // unique per client; a replayed id is not applied twice
+  ChangeKind kind;
+  int id = 0;             // row of the current month, for Update and Delete
+  long long ts = 0;
+  std::optional<std::string> spentOn;
+  std::optional<double> price;
+  std::optional<std::string> category;
+  std::optional<std::string> modeOfPayment;
+  std::optional<std::string> date;
+};
+
+struct SyncResult {
+  std::string mutationId;
+  std::string status; // "applied", "partial", "conflict" or "failed"
+  int id;             // the row written (the new one for an insert), 0 if none
+  std::vector<std::string> lostFields; // kept by a newer write
+};
+
+// A month table moved to Archive.db, with the rollup taken when it was moved
+struct ArchivedMonth {
+  int month;  // YYYYMM
+  long long rows;
+  double total;
+  std::string archivedAt; // UTC, YYYY-MM-DD HH:MM:SS
+};
+
+struct ArchiveResult {
+  bool ok;                 // false if any month failed; the rest still moved
+  std::vector<int> months; // YYYYMM of each month moved by this run
+  long long rows;
+  bool vacuumed;           // Detailed.db was rebuilt to give the space back
+};
+
 class FinanceDB {
 private:
   sqlite3 *mainDB;
   sqlite3 *detailedDB;
   std::string currentYearMonth;
   std::string currentTableName;
+  int currentMonth; // YYYYMM of currentTableName
+  SuggestIndex suggestIndex;
+  RefDataCache categoriesCache;
+  RefDataCache modesCache;
+
+  // Optional columnar copy of all expenses. Writes are mirrored into it as
+  // soon as it is enabled; reads only use it once the initial load is done.
+  ExpenseColumns analytics;
+  std::atomic<bool> analyticsEnabled{false};
+  std::atomic<bool> analyticsReady{false};
+  bool useAnalytics() const { return analyticsReady && analytics.usable(); }
+  static int tableMonth(const std::string &tableName);
+
+  // Limit rules for the current month, kept level with every write
+  BudgetAlerts budget;
+  void loadBudget();
+  // Price and CategoryId of a row of the current month, read before it is
+  // changed so the budget can take the old amount back
+  bool readAmount(int id, double &price, int &categoryId);
+  // SpentOn and dictionary ids of a row of the current month, read before it
+  // is changed so the suggestion weights of the old names can be taken back
+  bool readNames(int id, std::string &spentOn, int &categoryId, int &modeOfPaymentId);
+  // recordUse for a category or mode of payment given by id; 0 is ignored
+  void recordIdUse(SuggestKind kind, int id, int delta);
+
+  std::function<void(const ExpenseChange &)> changeListener;
+  // After-write upkeep: counts the write towards change log compaction, then
+  // publishes the change, or queues it while a sync batch is open
+  void notifyChange(ChangeKind kind, int id);
+  // Reads the row back (unless deleted) and hands it to changeListener
+  void publishChange(ChangeKind kind, int id);
+  // Changes of the open sync batch, published once it commits. Guarded by
+  // writeMutex.
+  bool batchOpen = false;
+  std::vector<std::pair<ChangeKind, int>> pendingChanges;
 
+  void openMainDB(const std::string &path);
+  void openDetailedDB(const std::string &path);
+  // Read-only connections to Detailed.db for list and report queries. They
+  // see committed data only, so anything that must read the writer's own
+  // uncommitted rows (e.g. inside applySync) stays on detailedDB.
+  ReadPool readers;
+  void openReadPool(const std::string &path);
+  // Archive.db, attached to every connection as schema "archive". Month
+  // tables there are found by the same unqualified names as live ones.
+  std::string archivePath;
+  bool archiveAttached = false;
+  void attachArchive();
+  bool archiveMonth(const std::string &table, long long &rows);
   void initMainDB();
   void initDetailedDB();
-  void executeSQL(sqlite3 *db, const std::string &sql);
+  std::vector<std::pair<int, std::string>> queryNames(const std::string &table);
+  bool migrateDictionaryColumns(const std::string &tableName);
+  void createPriceIndex(const std::string &tableName);
+  void createChangeLog();
+  void createChangeTriggers(const std::string &tableName);
+  std::atomic<long long> changeLogWrites{0};
+  void countChangeLogWrite();
+
+  // Offline sync keeps the stamp of the last write to every field (FieldClock,
+  // filled by triggers for ordinary writes) and the outcome of each applied
+  // mutation (SyncApplied), so a batch sent again is answered, not reapplied
+  void createSyncTables();
+  void createClockTriggers(const std::string &tableName);
+  // Held by every write to detailedDB, for a whole sync batch or archive
+  // move. Request threads share the connection, so without it their writes
+  // would land in another thread's open transaction. Recursive because a
+  // batch applies its mutations through addExpense and friends.
+  std::recursive_mutex writeMutex;
+  SyncResult applyMutation(const std::string &clientId, const SyncMutation &mutation);
+  void reloadRow(int id);
+  int resolveCategoryId(const std::string &category);
+  int resolveModeOfPaymentId(const std::string &modeOfPayment);
+  // Logs and returns false on error
+  bool executeSQL(sqlite3 *db, const std::string &sql);
+
+  // Passed to sqlite3_trace_v2 for one connection: metric series ids (see
+  // Metrics.h) and the name used in the query profile
+  struct ConnectionTrace {
+    FinanceDB *owner = nullptr;
+    const char *name = "";
+    int prepare = -1;
+    int statement = -1;
+  };
+  ConnectionTrace mainTrace;
+  ConnectionTrace detailedTrace;
+  ConnectionTrace replicaTrace;
+  // Set once by enableQueryProfiler before the server starts
+  std::unique_ptr<QueryProfiler> profiler;
+  // sqlite3_prepare_v2 on `db`, timed into sqlite_prepare_duration_seconds
+  int prepare(sqlite3 *db, const std::string &sql, sqlite3_stmt **stmt);
+  static int traceStatement(unsigned type, void *context, void *stmt, void *detail);
+  // Live month tables, plus the archived ones unless withArchive is false
+  std::vector<std::string> listExpenseTables(bool withArchive = true);
 
   double calculateCurrentSavings(double salary);
   std::string determineCondition(double savingPercentage);
@@ -48,15 +229,82 @@ public:
 
   // --- Methods for Adding Data ---
   bool addOrUpdateMonthlySummary(double salary, double limit);
-  bool addExpense(const std::string &spentOn, double price, const std::optional<std::string> &category = std::nullopt, const std::optional<std::string> &date = std::nullopt, const std::optional<std::string> &modeOfPayment = std::nullopt);
+  bool addExpense(const std::string &spentOn, double price, const std::optional<std::string> &category = std::nullopt, const std::optional<std::string> &date = std::nullopt, const std::optional<std::string> &modeOfPayment = std::nullopt, int *newId = nullptr);
   void updatePriority(const std::string &spentOn);
 
   // --- Methods for Categories and Mode of Payment ---
+  // Both lists are served from cached snapshots that are republished on add
   std::vector<std::string> getAllCategories();
+  std::shared_ptr<const RefDataSnapshot> getCategoriesSnapshot() const;
   bool addCategory(const std::string &category);
   std::vector<std::string> getAllModeOfPayment();
+  std::shared_ptr<const RefDataSnapshot> getModeOfPaymentSnapshot() const;
   bool addModeOfPayment(const std::string &modeOfPayment);
 
+  // Both databases opened; false means the server can't take traffic
+  bool isOpen() const { return mainDB && detailedDB; }
+  const ReadPool &readPool() const { return readers; }
+
+  // --- Warm-up ---
+  // Not done by the constructor so the server can start listening first;
+  // until these run, typeahead is empty and analytics fall back to SQL
+  void loadSuggestIndex();
+
+  // --- In-memory analytics ---
+  // Loads every month table into the columnar snapshot and serves
+  // calcTotalSpent, calcPriority, getItemStats and getMonthlyTotalsForYear
+  // from it
+  void enableAnalyticsSnapshot();
+
+  // --- Query profiling ---
+  // Groups every statement by SQL template; runs of at least thresholdMs are
+  // logged with their query plan to logPath (rotated)
+  void enableQueryProfiler(double thresholdMs, const std::string &logPath);
+  // JSON report, "null" when profiling is off
+  std::string queryProfileJson() const;
+  void resetQueryProfile();
+
+  // --- Change log ---
+  // Entries after `since`, oldest first, at most `limit` of them
+  ChangeLogPage getChangesSince(long long since, size_t limit);
+  // Newest seq in the log, 0 when empty
+  long long latestChangeSeq();
+  // Folds cold segments down to the newest entry per row, then drops the
+  // oldest entries beyond the size bound. Runs every CHANGE_LOG_SEGMENT writes.
+  void compactChangeLog();
+
+  // --- Backup ---
+  // Online copies of Main.db, Detailed.db and Archive.db into `directory`,
+  // made through the live connections so writes go on meanwhile
+  std::vector<BackupStats> backupTo(const std::string &directory);
+
+  // --- Archive ---
+  // Moves every month more than `keepMonths` months before the current one
+  // out of Detailed.db into Archive.db, then rebuilds Detailed.db so the
+  // file shrinks. Reads of a moved month are unchanged.
+  ArchiveResult archiveOldMonths(int keepMonths);
+  std::vector<ArchivedMonth> getArchivedMonths();
+
+  // --- Offline sync ---
+  // Applies a client's batch in a single transaction; one result per
+  // mutation, in order. Only rows of the current month can be targeted. If
+  // the COMMIT fails the batch is rolled back and every result is "failed".
+  std::vector<SyncResult> applySync(const std::string &clientId, const std::vector<SyncMutation> &mutations);
+
+  // --- Budget alerts ---
+  // Month limit is Overall.LimitAmount; a limit of 0 removes a category's
+  bool setCategoryLimit(const std::string &category, double limit);
+  std::vector<CategoryLimit> getCategoryLimits();
+  BudgetAlerts &budgetAlerts() { return budget; }
+
+  // --- Change feed ---
+  // Called after every successful add, edit and delete of an expense. Set
+  // once before the server starts.
+  void setChangeListener(std::function<void(const ExpenseChange &)> listener) { changeListener = std::move(listener); }
+
+  // --- Typeahead ---
+  std::vector<Suggestion> suggest(SuggestKind kind, const std::string &prefix, size_t limit = 10) const;
+
   // --- Methods for Viewing Data ---
   std::vector<MonthlySummary> getAllSummaries();
   std::vector<ExpenseRecord> getExpensesForMonth(const std::string &monthYear);
@@ -64,11 +312,22 @@ public:
 
   std::vector<ExpenseRecord> getSortedByVal();
   std::vector<ExpenseRecord> calcPriority();
+  // Count, total, min, max and p50/p90 price of one item over the months
+  // fromMonthYear..toMonthYear (MM_YYYY, inclusive; empty means unbounded)
+  ItemStats getItemStats(const std::string &spentOn, const std::string &fromMonthYear, const std::string &toMonthYear);
   std::vector<ExpenseRecord> calcSortByPrice(bool order);
+  // The k most (or least) expensive expenses of the current month, read off
+  // the Price index without sorting the month
+  std::vector<ExpenseRecord> topByPrice(size_t k, bool descending = true);
+  // Nearest-rank price quantiles (fractions in (0, 1]) of the current month
+  PriceDistribution priceQuantiles(const std::vector<double> &quantiles);
   std::vector<ExpenseRecord> getRangeOfDate(std::string start_date, std::string end_date);
   std::vector<ExpenseRecord> getItemByDateRange(std::string item, std::string start_date, std::string end_date);
   std::map<std::string, double> getMonthlyTotalsForYear(int year);
   double calcTotalSpent();
+  // Spend over the last 7/30/90 days (by expense date, across month tables)
+  // plus what the burn rate is measured against
+  SpendOverview getSpendOverview();
   bool deleteSelected(int id);
 
   bool updateSelected2(int id, const std::optional<std::string> &spentOn,
@@ -0,0 +1,91 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+enum class LogLevel { Debug = 0, Info = 1, Warn = 2, Error = 3 };
+
+// Asynchronous logger. Request threads format their record and hand it to a
+// bounded lock-free ring (one CAS to claim a slot, no lock, no I/O); a
+// background thread drains the ring in batches and writes Warn/Error lines to
+// stderr and the rest to stdout, flushing once per batch. When the ring is
+// full the record is dropped and counted instead of blocking the caller.
+class Logger {
+private:
+  struct Slot {
+    std::atomic<size_t> sequence;
+    LogLevel level;
+    std::chrono::system_clock::time_point time;
+    std::string text;
+  };
+
+  static const size_t CAPACITY = 8192; // power of two
+  std::unique_ptr<Slot[]> ring;
+  std::atomic<size_t> enqueuePos{0};
+  size_t dequeuePos = 0; // consumer thread only
+  std::atomic<int> minLevel{static_cast<int>(LogLevel::Info)};
+  std::atomic<uint64_t> droppedCount{0};
+  uint64_t droppedReported = 0;
+
+  std::atomic<bool> stopping{false};
+  std::mutex wakeMutex;
+  std::condition_variable wake;
+  std::thread worker;
+
+  Logger();
+  void run();
+  size_t drain();
+
+public:
+  ~Logger();
+  Logger(const Logger &) = delete;
+  Logger &operator=(const Logger &) = delete;
+
+  static Logger &instance();
+
+  void setLevel(LogLevel level) { minLevel = static_cast<int>(level); }
+  bool enabled(LogLevel level) const { return static_cast<int>(level) >= minLevel; }
+  // Never blocks; returns false (and counts the record as dropped) when full
+  bool push(LogLevel level, std::string &&text);
+  uint64_t dropped() const { return droppedCount; }
+};
+
+// One structured record: a message plus key=value fields, queued when the
+// temporary goes out of scope at the end of the statement, e.g.
+//   logError("Execution failed").field("table", tableName).field("error", sqlite3_errmsg(db));
+class LogRecord {
+private:
+  LogLevel level;
+  bool active;
+  std::string text;
+
+  void appendValue(const std::string &value);
+
+public:
+  LogRecord(LogLevel level, const std::string &message);
+  ~LogRecord();
+  LogRecord(const LogRecord &) = delete;
+  LogRecord &operator=(const LogRecord &) = delete;
+
+  LogRecord &field(const char *key, const std::string &value);
+  LogRecord &field(const char *key, const char *value);
+  LogRecord &field(const char *key, long long value);
+  LogRecord &field(const char *key, int value) { return field(key, static_cast<long long>(value)); }
+  LogRecord &field(const char *key, size_t value) { return field(key, static_cast<long long>(value)); }
+  LogRecord &field(const char *key, double value);
+};
+
+inline LogRecord logDebug(const std::string &message) { return LogRecord(LogLevel::Debug, message); }
+inline LogRecord logInfo(const std::string &message) { return LogRecord(LogLevel::Info, message); }
+inline LogRecord logWarn(const std::string &message) { return LogRecord(LogLevel::Warn, message); }
+inline LogRecord logError(const std::string &message) { return LogRecord(LogLevel::Error, message); }
+
+#endif // LOGGER_H
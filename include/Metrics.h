@@ -0,0 +1,43 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+enum class MetricType { Counter, Histogram };
+
+// Process-wide metrics registry rendered in the Prometheus text format.
+//
+// Every thread that records a value gets its own shard of counters the first
+// time it does so. A shard only ever has one writer, so recording is a relaxed
+// load + store with no lock and no shared cache line; /metrics sums the shards
+// when it is scraped. Series are identified by a small integer id returned by
+// series(), which hot paths can keep in a static.
+class Metrics {
+public:
+  static const size_t MAX_SERIES = 1024;
+  // Latency bucket upper bounds in seconds; the last bucket is +Inf
+  static const size_t NUM_BUCKETS = 14;
+  static const double BUCKET_BOUNDS[NUM_BUCKETS - 1];
+
+  // Finds or registers the series `name{labels}` (labels already formatted,
+  // e.g. `route="/summary",status="200"`). Returns -1 once MAX_SERIES distinct
+  // series exist; recording into -1 is a no-op.
+  static int series(MetricType type, const std::string &name, const std::string &labels = "");
+  static void describe(const std::string &name, const std::string &help);
+
+  static void add(int id, uint64_t n = 1);
+  static void observe(int id, double seconds);
+  // Gauges and sampled counters read a value kept elsewhere (e.g. by Crow)
+  // when /metrics is rendered
+  static void gauge(const std::string &name, const std::string &help, std::function<double()> sample);
+  static void sampledCounter(const std::string &name, const std::string &help, std::function<double()> sample);
+
+  static std::string render();
+  // Escapes a label value (backslash, quote, newline)
+  static std::string label(const std::string &value);
+};
+
+#endif // METRICS_H
@@ -0,0 +1,50 @@
+#ifndef PRICERANKS_H
+#define PRICERANKS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Multiset of prices with rank lookups: a treap over distinct prices, each
+// node carrying its repeat count and the number of prices in its subtree.
+// add, erase and select are O(log n) expected, so a quantile of a month of
+// any size is a single descent. Nodes live in one vector and are linked by
+// index; erased slots are reused.
+class PriceRanks {
+private:
+  struct Node {
+    double price;
+    uint32_t count;    // copies of this price
+    uint32_t subtree;  // prices in this subtree, copies included
+    uint32_t priority;
+    int32_t left = -1;
+    int32_t right = -1;
+  };
+
+  std::vector<Node> nodes;
+  std::vector<int32_t> freeSlots;
+  int32_t root = -1;
+  uint32_t seed = 0x9e3779b9u;
+
+  uint32_t subtree(int32_t node) const { return node < 0 ? 0 : nodes[node].subtree; }
+  void pull(int32_t node);
+  uint32_t nextPriority();
+  // Splits `node` into prices < price (left) and >= price (right), or
+  // <= price and > price when `inclusive`
+  void split(int32_t node, double price, bool inclusive, int32_t &left, int32_t &right);
+  int32_t merge(int32_t left, int32_t right);
+
+public:
+  void add(double price);
+  // Removes one copy; false if the price isn't present
+  bool erase(double price);
+  void clear();
+
+  size_t size() const { return subtree(root); }
+  bool empty() const { return root < 0; }
+  // The price at 0-based `rank` in ascending order; rank < size()
+  double select(size_t rank) const;
+  size_t memoryBytes() const;
+};
+
+#endif // PRICERANKS_H
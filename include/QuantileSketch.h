@@ -0,0 +1,44 @@
+#ifndef QUANTILESKETCH_H
+#define QUANTILESKETCH_H
+
+#include <cstddef>
+#include <vector>
+
+// Streaming quantile estimate (merging t-digest). Values are buffered and
+// folded into weighted centroids whose size is capped tighter near the tails,
+// so p50/p90 stay accurate while memory is bounded by COMPRESSION regardless
+// of how many values were added. Small streams stay exact: until the caps
+// allow merging, every value is its own centroid. Sketches of disjoint
+// streams can be merged, which is how per-month sketches answer a window.
+// Values can't be removed; callers rebuild the sketch instead.
+class QuantileSketch {
+private:
+  struct Centroid {
+    double mean;
+    double weight;
+  };
+
+  static constexpr double COMPRESSION = 50.0;
+  static const size_t BUFFER_SIZE = 64;
+
+  std::vector<Centroid> centroids; // sorted by mean once compressed
+  std::vector<double> buffer;      // values not yet folded in
+  double totalWeight = 0.0;
+
+  void fold(std::vector<Centroid> &incoming);
+
+public:
+  void add(double value);
+  void merge(const QuantileSketch &other);
+  // Folds the buffer in; quantile() requires it
+  void compress();
+  void clear();
+
+  double count() const { return totalWeight; }
+  // Interpolated value at fraction q of the stream, clamped to [min, max];
+  // 0 when empty. Call compress() first.
+  double quantile(double q, double min, double max) const;
+  size_t memoryBytes() const;
+};
+
+#endif // QUANTILESKETCH_H
@@ -0,0 +1,92 @@
+#ifndef QUERYPROFILER_H
+#define QUERYPROFILER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <sqlite3.h>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+// Per-statement profile fed from FinanceDB's sqlite3_trace_v2 hook.
+//
+// Statements are grouped by template: string and number literals become '?'
+// and month tables collapse to expenses_MM_YYYY, so the same query against
+// different months or values shares one row. Runs slower than the threshold
+// are also kept (last maxSlowEntries) with their expanded SQL and EXPLAIN QUERY
+// PLAN, and appended to a log file that rotates at maxLogBytes, keeping
+// logFiles old copies (path.1 is the newest).
+//
+// record() runs inside the trace callback, so it only counts; the plans of
+// slow runs are worked out on a background thread through the owner's
+// ExplainFn, never on the traced connection mid-statement.
+class QueryProfiler {
+public:
+  // EXPLAIN QUERY PLAN of `sql` as run on the named connection
+  using ExplainFn = std::function<std::string(const std::string &db, const std::string &sql)>;
+
+private:
+  struct TemplateStats {
+    std::string db;
+    uint64_t count = 0;
+    double totalSeconds = 0;
+    double maxSeconds = 0;
+    uint64_t steps = 0;
+    std::string plan; // filled the first time a run of this template is slow
+  };
+  struct SlowQuery {
+    std::string key;
+    std::string time;
+    std::string db;
+    std::string sql;
+    std::string templateSql;
+    double seconds;
+    uint64_t steps;
+    std::string plan;
+  };
+
+  double thresholdSeconds;
+  std::string logPath;
+  size_t maxLogBytes;
+  int logFiles;
+  size_t maxSlowEntries;
+  ExplainFn explainFn;
+
+  mutable std::mutex mutex;
+  std::unordered_map<std::string, TemplateStats> templates;
+  std::deque<SlowQuery> slow;
+  std::ofstream log;
+
+  // Slow runs waiting for their plan, at most maxSlowEntries
+  std::deque<SlowQuery> pending;
+  std::condition_variable wake;
+  bool stopping = false;
+  std::thread worker;
+
+  void run();
+  void writeLog(const SlowQuery &entry);
+
+public:
+  QueryProfiler(double thresholdMs, const std::string &logPath, ExplainFn explainFn, size_t maxLogBytes = 1 << 20,
+                int logFiles = 3, size_t maxSlowEntries = 100);
+  ~QueryProfiler();
+  QueryProfiler(const QueryProfiler &) = delete;
+  QueryProfiler &operator=(const QueryProfiler &) = delete;
+
+  // Called once a statement finished; steps are the VM steps it took
+  void record(const char *dbName, sqlite3_stmt *stmt, double seconds, uint64_t steps);
+  // {"threshold_ms", "statements": [...by total time], "slow": [...newest first]}
+  std::string toJson() const;
+  void reset();
+
+  static std::string normalize(const char *sql);
+  // One line per plan row, indented by depth
+  static std::string explain(sqlite3 *db, const char *sql);
+};
+
+#endif // QUERYPROFILER_H
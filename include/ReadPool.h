@@ -0,0 +1,59 @@
+#ifndef READPOOL_H
+#define READPOOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <sqlite3.h>
+#include <string>
+#include <vector>
+
+// A fixed set of read-only connections to one database file. With the file in
+// WAL mode every read runs on its own snapshot, so a long report neither waits
+// for writes on the main connection nor holds them up. A lease gives one
+// connection to one thread until it goes out of scope; when all are leased,
+// the next caller waits for one to come back.
+class ReadPool {
+public:
+  class Lease {
+    ReadPool *pool;
+    sqlite3 *connection;
+
+  public:
+    Lease(ReadPool *pool, sqlite3 *connection) : pool(pool), connection(connection) {}
+    Lease(Lease &&other) noexcept : pool(other.pool), connection(other.connection) { other.pool = nullptr; }
+    Lease(const Lease &) = delete;
+    Lease &operator=(const Lease &) = delete;
+    ~Lease();
+    sqlite3 *db() const { return connection; }
+  };
+
+private:
+  mutable std::mutex mutex;
+  std::condition_variable returned;
+  std::vector<sqlite3 *> connections;
+  std::vector<sqlite3 *> idle;
+
+  void release(sqlite3 *connection);
+
+public:
+  ReadPool() = default;
+  ReadPool(const ReadPool &) = delete;
+  ReadPool &operator=(const ReadPool &) = delete;
+  ~ReadPool();
+
+  // Opens `size` connections and runs `setup` on each. Returns false, with no
+  // connection kept, if any of them fails to open or `setup` returns false.
+  bool open(const std::string &path, size_t size, const std::function<bool(sqlite3 *)> &setup);
+  // A pooled connection, or `fallback` (not pooled, not returned) while the
+  // pool isn't open
+  Lease lease(sqlite3 *fallback);
+  // Closes every connection; none may be leased
+  void close();
+
+  size_t size() const;
+  size_t busy() const;
+};
+
+#endif // READPOOL_H
@@ -0,0 +1,48 @@
+#ifndef REFDATACACHE_H
+#define REFDATACACHE_H
+
+#include "Compression.h"
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Immutable view of a reference list (categories, modes of payment) together
+// with its pre-serialized JSON body and strong ETag. It doubles as the id<->name
+// dictionary used to decode the integer ids stored in expense rows.
+struct RefDataSnapshot {
+  std::vector<std::string> names; // sorted by name
+  std::unordered_map<int, std::string> nameById;
+  std::unordered_map<std::string, int> idByName;
+  std::string json;
+  std::string etag;
+  // json with its gzip/deflate/zstd forms, each compressed once on first use
+  std::unique_ptr<PrecompressedBody> encodedJson;
+
+  // Empty string for unknown ids, including 0 (no value)
+  const std::string &name(int id) const;
+  // 0 when the name is not in the dictionary
+  int id(const std::string &name) const;
+};
+
+// Holds the current RefDataSnapshot behind an atomically swapped shared_ptr.
+// Readers take one atomic load and never block; writers rebuild a whole new
+// snapshot and publish it, serialized by writeMutex so a slow writer can't
+// overwrite a newer list with an older one.
+class RefDataCache {
+private:
+  std::shared_ptr<const RefDataSnapshot> current;
+  std::mutex writeMutex;
+
+public:
+  RefDataCache();
+
+  std::shared_ptr<const RefDataSnapshot> get() const;
+  // Runs `loader` and publishes its (id, name) rows as the new snapshot
+  void refresh(const std::function<std::vector<std::pair<int, std::string>>()> &loader);
+};
+
+#endif // REFDATACACHE_H
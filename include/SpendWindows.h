@@ -0,0 +1,43 @@
+#ifndef SPENDWINDOWS_H
+#define SPENDWINDOWS_H
+
+#include <array>
+#include <map>
+#include <mutex>
+
+// Spend over the last N days (N <= MAX_DAYS, today included), as a ring of
+// daily totals. Running sums for the 7/30/90-day windows are adjusted on every
+// write and when the ring advances past midnight, so both writes and reads of
+// those windows are O(1). Expenses dated in the future wait in a side map
+// until their day arrives; ones older than MAX_DAYS are ignored.
+class SpendWindows {
+public:
+  static constexpr int MAX_DAYS = 90;
+  static constexpr int WINDOW_COUNT = 3;
+  static const int WINDOWS[WINDOW_COUNT]; // 7, 30, 90
+
+private:
+  std::array<double, MAX_DAYS> ring{}; // ring[day % MAX_DAYS]
+  std::array<double, WINDOW_COUNT> sums{};
+  std::map<int, double> future; // day number -> total
+  int today = 0;                // day number of the newest slot, 0 before first use
+  mutable std::mutex mutex;
+
+  // Caller holds the mutex
+  void advanceTo(int day);
+
+public:
+  // Adds `amount` (negative to take it back) to the day given as YYYYMMDD;
+  // a date of 0 is ignored
+  void add(int yyyymmdd, double amount);
+  void clear();
+  // Spend in the `days` (1..MAX_DAYS) days ending today
+  double total(int days);
+
+  // Days since 1970-01-01 for a YYYYMMDD date
+  static int dayNumber(int yyyymmdd);
+  // Local calendar day, as a day number
+  static int currentDay();
+};
+
+#endif // SPENDWINDOWS_H
@@ -0,0 +1,44 @@
+#ifndef STATICASSETS_H
+#define STATICASSETS_H
+
+#include "Compression.h"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// One file of the frontend, held in memory with everything a response needs:
+// the body in every encoding, its strong ETag and the version token used in
+// fingerprinted URLs (?v=<version>).
+struct StaticAsset {
+  std::string contentType;
+  std::string etag;
+  std::string version; // etag without quotes
+  std::unique_ptr<PrecompressedBody> body;
+};
+
+// Read-only table of frontend files keyed by URL path ("/index.html"). It is
+// filled once at startup, before the server accepts connections, and only read
+// afterwards, so lookups need no locking and serving a file touches no disk.
+class StaticAssets {
+private:
+  std::unordered_map<std::string, std::shared_ptr<const StaticAsset>> byPath;
+
+public:
+  // Loads every regular file directly under `dir` and precompresses the
+  // compressible ones. Returns the number of files loaded, 0 if `dir` can't
+  // be read.
+  size_t load(const std::string &dir);
+  // Makes `path` serve the same asset as `target` (e.g. "/" -> "/index.html");
+  // false if `target` is not loaded
+  bool alias(const std::string &path, const std::string &target);
+
+  // nullptr when no asset is served at `path`
+  const StaticAsset *find(const std::string &path) const;
+  std::vector<std::string> paths() const;
+};
+
+// Content-Type for a file name, by extension
+std::string contentTypeFor(const std::string &fileName);
+
+#endif // STATICASSETS_H
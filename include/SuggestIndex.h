@@ -0,0 +1,57 @@
+#ifndef SUGGESTINDEX_H
+#define SUGGESTINDEX_H
+
+#include <cstddef>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+// Kinds of names the typeahead index can complete
+enum class SuggestKind { Item = 0, Category = 1, ModeOfPayment = 2 };
+
+// A single completion returned by SuggestIndex::suggest
+struct Suggestion {
+  std::string name;
+  int weight;
+};
+
+// In-memory prefix index for typeahead. Each kind keeps its names sorted by a
+// lowercase key so a prefix lookup is one binary search plus a short scan.
+// Every kind is capped at maxEntriesPerKind; once full, a newly used name
+// evicts the lightest entry and inherits its weight, so the index keeps
+// learning without letting one use outrank established names.
+class SuggestIndex {
+private:
+  struct Entry {
+    std::string key; // lowercase form used for prefix matching
+    std::string name; // refinedString form returned to the client
+    int weight;
+  };
+
+  static const int KIND_COUNT = 3;
+  std::vector<Entry> entries[KIND_COUNT];
+  size_t maxEntriesPerKind;
+  mutable std::shared_mutex mutex;
+
+  void upsert(std::vector<Entry> &list, const std::string &name, int weight, bool add);
+  // Lowers a name's weight by `uses`, not below 0; at 0 it is removed if dropUnused
+  void takeBack(std::vector<Entry> &list, const std::string &name, int uses, bool dropUnused);
+
+public:
+  explicit SuggestIndex(size_t maxEntriesPerKind = 4096);
+
+  // Adds weight to a name, inserting it if it is not indexed yet. A negative
+  // delta takes uses back (a row renamed or deleted); an item left with no
+  // uses is dropped.
+  void recordUse(SuggestKind kind, const std::string &name, int delta = 1);
+  // Overwrites the weight of a name, inserting it if it is not indexed yet
+  void setWeight(SuggestKind kind, const std::string &name, int weight);
+  void clear(SuggestKind kind);
+
+  // Returns up to `limit` names starting with `prefix` (case-insensitive),
+  // heaviest first
+  std::vector<Suggestion> suggest(SuggestKind kind, const std::string &prefix, size_t limit) const;
+  size_t size(SuggestKind kind) const;
+};
+
+#endif // SUGGESTINDEX_H
@@ -6,6 +6,13 @@
 // Function to format date from DD-MM-YYYY to YYYY-MM-DD
 std::string format_date(const std::string &date_str); // Declaration only
 std::string refinedString(const std::string &str);
+// Parses the date prefix of an expense key (DD_MM_YYYY_..., YYYY-MM-DD... or
+// YYYY_MM_DD...) into YYYYMMDD. Returns 0 if no date can be read.
+int parseExpenseDate(const std::string &dayMonthYear);
+// Escapes a string for embedding inside a JSON string literal
+std::string jsonEscape(const std::string &str);
+// Strong ETag (quoted 64-bit FNV-1a hex digest) for a response body
+std::string makeETag(const std::string &body);
 template <typename T> bool isNumber(const T &a) {
   return std::is_arithmetic<T>::value;
 }
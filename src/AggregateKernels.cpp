@@ -0,0 +1,266 @@
+#include "AggregateKernels.h"
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define EXPENSE_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+/***************************************************/
+/**************** SCALAR REFERENCE *****************/
+/***************************************************/
+
+static double scalarSum(const double* values, size_t n) {
+    double total = 0.0;
+    for (size_t i = 0; i < n; ++i) total += values[i];
+    return total;
+}
+
+static MinMax scalarMinMax(const double* values, size_t n) {
+    MinMax result = {std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity()};
+    for (size_t i = 0; i < n; ++i) {
+        if (values[i] < result.min) result.min = values[i];
+        if (values[i] > result.max) result.max = values[i];
+    }
+    return result;
+}
+
+static double scalarSumInRange(const double* values, const int32_t* keys, size_t n, int32_t lo, int32_t hi) {
+    double total = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        if (keys[i] >= lo && keys[i] <= hi) total += values[i];
+    }
+    return total;
+}
+
+static double scalarSumForCode(const double* values, const uint16_t* codes, size_t n, uint16_t code) {
+    double total = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        if (codes[i] == code) total += values[i];
+    }
+    return total;
+}
+
+static void scalarHistogram(const double* values, const int32_t* keys, size_t n, int32_t base, size_t buckets, double* out) {
+    for (size_t i = 0; i < n; ++i) {
+        // Unsigned compare folds the keys[i] < base check into the upper bound
+        uint32_t bucket = static_cast<uint32_t>(keys[i] - base);
+        if (bucket < buckets) out[bucket] += values[i];
+    }
+}
+
+const AggregateKernels& scalarKernels() {
+    static const AggregateKernels kernels = {"scalar", scalarSum, scalarMinMax, scalarSumInRange,
+                                             scalarSumForCode, scalarHistogram};
+    return kernels;
+}
+
+#ifdef EXPENSE_X86_KERNELS
+
+/***************************************************/
+/********************** SSE2 ***********************/
+/***************************************************/
+
+__attribute__((target("sse2"))) static double hsum128(__m128d v) {
+    return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+}
+
+__attribute__((target("sse2"))) static double sse2Sum(const double* values, size_t n) {
+    // Two accumulators hide the add latency
+    __m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc0 = _mm_add_pd(acc0, _mm_loadu_pd(values + i));
+        acc1 = _mm_add_pd(acc1, _mm_loadu_pd(values + i + 2));
+    }
+    double total = hsum128(_mm_add_pd(acc0, acc1));
+    for (; i < n; ++i) total += values[i];
+    return total;
+}
+
+__attribute__((target("sse2"))) static MinMax sse2MinMax(const double* values, size_t n) {
+    MinMax result = scalarMinMax(nullptr, 0);
+    size_t i = 0;
+    if (n >= 2) {
+        __m128d lo = _mm_loadu_pd(values), hi = lo;
+        for (i = 2; i + 2 <= n; i += 2) {
+            __m128d v = _mm_loadu_pd(values + i);
+            lo = _mm_min_pd(lo, v);
+            hi = _mm_max_pd(hi, v);
+        }
+        result.min = _mm_cvtsd_f64(_mm_min_sd(lo, _mm_unpackhi_pd(lo, lo)));
+        result.max = _mm_cvtsd_f64(_mm_max_sd(hi, _mm_unpackhi_pd(hi, hi)));
+    }
+    for (; i < n; ++i) {
+        if (values[i] < result.min) result.min = values[i];
+        if (values[i] > result.max) result.max = values[i];
+    }
+    return result;
+}
+
+// All-ones 64-bit lanes where lo <= key <= hi, for the two keys at `keys`
+__attribute__((target("sse2"))) static __m128d sse2RangeMask(const int32_t* keys, __m128i lo, __m128i hi) {
+    __m128i k = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(keys));
+    __m128i outside = _mm_or_si128(_mm_cmplt_epi32(k, lo), _mm_cmpgt_epi32(k, hi));
+    __m128i inside = _mm_andnot_si128(outside, _mm_set1_epi32(-1));
+    return _mm_castsi128_pd(_mm_unpacklo_epi32(inside, inside));
+}
+
+__attribute__((target("sse2"))) static double sse2SumInRange(const double* values, const int32_t* keys, size_t n, int32_t lo, int32_t hi) {
+    __m128i vlo = _mm_set1_epi32(lo), vhi = _mm_set1_epi32(hi);
+    __m128d acc = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        acc = _mm_add_pd(acc, _mm_and_pd(_mm_loadu_pd(values + i), sse2RangeMask(keys + i, vlo, vhi)));
+    }
+    return hsum128(acc) + scalarSumInRange(values + i, keys + i, n - i, lo, hi);
+}
+
+__attribute__((target("sse2"))) static double sse2SumForCode(const double* values, const uint16_t* codes, size_t n, uint16_t code) {
+    __m128i vcode = _mm_set1_epi32(code);
+    __m128i zero = _mm_setzero_si128();
+    __m128d acc = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        int32_t pair;
+        std::memcpy(&pair, codes + i, sizeof(pair));
+        __m128i c = _mm_unpacklo_epi16(_mm_cvtsi32_si128(pair), zero);
+        __m128i eq = _mm_cmpeq_epi32(c, vcode);
+        __m128d mask = _mm_castsi128_pd(_mm_unpacklo_epi32(eq, eq));
+        acc = _mm_add_pd(acc, _mm_and_pd(_mm_loadu_pd(values + i), mask));
+    }
+    return hsum128(acc) + scalarSumForCode(values + i, codes + i, n - i, code);
+}
+
+const AggregateKernels* sse2Kernels() {
+    // Scatter into buckets doesn't vectorize without conflict detection, so
+    // the histogram stays scalar below AVX2
+    static const AggregateKernels kernels = {"sse2", sse2Sum, sse2MinMax, sse2SumInRange,
+                                             sse2SumForCode, scalarHistogram};
+    return __builtin_cpu_supports("sse2") ? &kernels : nullptr;
+}
+
+/***************************************************/
+/********************** AVX2 ***********************/
+/***************************************************/
+
+__attribute__((target("avx2"))) static double hsum256(__m256d v) {
+    __m128d s = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+}
+
+__attribute__((target("avx2"))) static double avx2Sum(const double* values, size_t n) {
+    __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_add_pd(acc0, _mm256_loadu_pd(values + i));
+        acc1 = _mm256_add_pd(acc1, _mm256_loadu_pd(values + i + 4));
+    }
+    double total = hsum256(_mm256_add_pd(acc0, acc1));
+    for (; i < n; ++i) total += values[i];
+    return total;
+}
+
+__attribute__((target("avx2"))) static MinMax avx2MinMax(const double* values, size_t n) {
+    MinMax result = scalarMinMax(nullptr, 0);
+    size_t i = 0;
+    if (n >= 4) {
+        __m256d lo = _mm256_loadu_pd(values), hi = lo;
+        for (i = 4; i + 4 <= n; i += 4) {
+            __m256d v = _mm256_loadu_pd(values + i);
+            lo = _mm256_min_pd(lo, v);
+            hi = _mm256_max_pd(hi, v);
+        }
+        __m128d lo2 = _mm_min_pd(_mm256_castpd256_pd128(lo), _mm256_extractf128_pd(lo, 1));
+        __m128d hi2 = _mm_max_pd(_mm256_castpd256_pd128(hi), _mm256_extractf128_pd(hi, 1));
+        result.min = _mm_cvtsd_f64(_mm_min_sd(lo2, _mm_unpackhi_pd(lo2, lo2)));
+        result.max = _mm_cvtsd_f64(_mm_max_sd(hi2, _mm_unpackhi_pd(hi2, hi2)));
+    }
+    for (; i < n; ++i) {
+        if (values[i] < result.min) result.min = values[i];
+        if (values[i] > result.max) result.max = values[i];
+    }
+    return result;
+}
+
+// All-ones 64-bit lanes where lo <= key <= hi, for the four keys at `keys`
+__attribute__((target("avx2"))) static __m256d avx2RangeMask(const int32_t* keys, __m128i lo, __m128i hi) {
+    __m128i k = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys));
+    __m128i outside = _mm_or_si128(_mm_cmplt_epi32(k, lo), _mm_cmpgt_epi32(k, hi));
+    __m128i inside = _mm_andnot_si128(outside, _mm_set1_epi32(-1));
+    return _mm256_castsi256_pd(_mm256_cvtepi32_epi64(inside));
+}
+
+__attribute__((target("avx2"))) static double avx2SumInRange(const double* values, const int32_t* keys, size_t n, int32_t lo, int32_t hi) {
+    __m128i vlo = _mm_set1_epi32(lo), vhi = _mm_set1_epi32(hi);
+    __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_add_pd(acc0, _mm256_and_pd(_mm256_loadu_pd(values + i), avx2RangeMask(keys + i, vlo, vhi)));
+        acc1 = _mm256_add_pd(acc1, _mm256_and_pd(_mm256_loadu_pd(values + i + 4), avx2RangeMask(keys + i + 4, vlo, vhi)));
+    }
+    return hsum256(_mm256_add_pd(acc0, acc1)) + scalarSumInRange(values + i, keys + i, n - i, lo, hi);
+}
+
+__attribute__((target("avx2"))) static double avx2SumForCode(const double* values, const uint16_t* codes, size_t n, uint16_t code) {
+    __m256i vcode = _mm256_set1_epi64x(code);
+    __m256d acc = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i c = _mm256_cvtepu16_epi64(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(codes + i)));
+        __m256d mask = _mm256_castsi256_pd(_mm256_cmpeq_epi64(c, vcode));
+        acc = _mm256_add_pd(acc, _mm256_and_pd(_mm256_loadu_pd(values + i), mask));
+    }
+    return hsum256(acc) + scalarSumForCode(values + i, codes + i, n - i, code);
+}
+
+__attribute__((target("avx2"))) static void avx2Histogram(const double* values, const int32_t* keys, size_t n, int32_t base, size_t buckets, double* out) {
+    // Bucket indices are computed and range-checked four at a time. Keys outside
+    // the range are redirected to a spill bucket so the scalar scatter has no
+    // data-dependent branches, and each lane gets its own copy of the buckets
+    // so consecutive rows in the same month don't serialize on one add.
+    const size_t stride = buckets + 1;
+    std::vector<double> acc(4 * stride, 0.0);
+    __m128i vbase = _mm_set1_epi32(base);
+    __m128i vlimit = _mm_set1_epi32(static_cast<int32_t>(buckets));
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i idx = _mm_sub_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i)), vbase);
+        __m128i inside = _mm_and_si128(_mm_cmpgt_epi32(idx, _mm_set1_epi32(-1)), _mm_cmplt_epi32(idx, vlimit));
+        idx = _mm_blendv_epi8(vlimit, idx, inside);
+        alignas(16) int32_t lanes[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes), idx);
+        acc[lanes[0]] += values[i];
+        acc[stride + lanes[1]] += values[i + 1];
+        acc[2 * stride + lanes[2]] += values[i + 2];
+        acc[3 * stride + lanes[3]] += values[i + 3];
+    }
+    for (size_t b = 0; b < buckets; ++b) {
+        out[b] += (acc[b] + acc[stride + b]) + (acc[2 * stride + b] + acc[3 * stride + b]);
+    }
+    scalarHistogram(values + i, keys + i, n - i, base, buckets, out);
+}
+
+const AggregateKernels* avx2Kernels() {
+    static const AggregateKernels kernels = {"avx2", avx2Sum, avx2MinMax, avx2SumInRange,
+                                             avx2SumForCode, avx2Histogram};
+    return __builtin_cpu_supports("avx2") ? &kernels : nullptr;
+}
+
+#else
+
+const AggregateKernels* sse2Kernels() { return nullptr; }
+const AggregateKernels* avx2Kernels() { return nullptr; }
+
+#endif // EXPENSE_X86_KERNELS
+
+const AggregateKernels& activeKernels() {
+    static const AggregateKernels& kernels = [] () -> const AggregateKernels& {
+        if (const AggregateKernels* k = avx2Kernels()) return *k;
+        if (const AggregateKernels* k = sse2Kernels()) return *k;
+        return scalarKernels();
+    }();
+    return kernels;
+}
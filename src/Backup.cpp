@@ -0,0 +1,251 @@
+#include "Backup.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <ctime>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+BackupStats backupDatabase(sqlite3* source, const std::string& destPath, const std::string& name, const char* schema) {
+    BackupStats stats;
+    stats.name = name;
+    if (!source) {
+        stats.error = "database not open";
+        return stats;
+    }
+    std::remove(destPath.c_str());
+    sqlite3* dest = nullptr;
+    if (sqlite3_open(destPath.c_str(), &dest) != SQLITE_OK) {
+        stats.error = sqlite3_errmsg(dest);
+        sqlite3_close(dest);
+        return stats;
+    }
+    sqlite3_backup* backup = sqlite3_backup_init(dest, "main", source, schema);
+    if (!backup) {
+        stats.error = sqlite3_errmsg(dest);
+        sqlite3_close(dest);
+        return stats;
+    }
+
+    std::string labels = "db=\"" + Metrics::label(name) + "\"";
+    int stepSeries = Metrics::series(MetricType::Histogram, "backup_step_duration_seconds", labels);
+    auto start = std::chrono::steady_clock::now();
+    int rc;
+    do {
+        auto stepStart = std::chrono::steady_clock::now();
+        rc = sqlite3_backup_step(backup, BACKUP_STEP_PAGES);
+        double stall = std::chrono::duration<double>(std::chrono::steady_clock::now() - stepStart).count();
+        Metrics::observe(stepSeries, stall);
+        stats.stallSeconds += stall;
+        stats.maxStallSeconds = std::max(stats.maxStallSeconds, stall);
+        stats.steps++;
+        // Busy or locked just means a writer got there first; try again after the pause
+        if (rc == SQLITE_OK || rc == SQLITE_BUSY || rc == SQLITE_LOCKED) sqlite3_sleep(BACKUP_STEP_PAUSE_MS);
+    } while (rc == SQLITE_OK || rc == SQLITE_BUSY || rc == SQLITE_LOCKED);
+
+    stats.pages = sqlite3_backup_pagecount(backup);
+    sqlite3_backup_finish(backup);
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (rc != SQLITE_DONE) {
+        stats.error = sqlite3_errstr(rc);
+    } else {
+        stats.ok = true;
+        sqlite3_stmt* stmt;
+        if (sqlite3_prepare_v2(dest, "PRAGMA page_size;", -1, &stmt, nullptr) == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW) {
+            stats.bytes = stats.pages * sqlite3_column_int64(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+        Metrics::add(Metrics::series(MetricType::Counter, "backup_bytes_total", labels), static_cast<uint64_t>(stats.bytes));
+    }
+    sqlite3_close(dest);
+
+    if (stats.ok) {
+        logInfo("Backup written")
+            .field("db", name)
+            .field("pages", stats.pages)
+            .field("steps", stats.steps)
+            .field("ms", stats.seconds * 1000)
+            .field("mib_per_s", stats.seconds > 0 ? stats.bytes / stats.seconds / (1 << 20) : 0.0)
+            .field("stall_ms", stats.stallSeconds * 1000)
+            .field("max_stall_ms", stats.maxStallSeconds * 1000);
+    } else {
+        logError("Backup failed").field("db", name).field("error", stats.error);
+    }
+    return stats;
+}
+
+bool restoreDatabase(const std::string& snapshotPath, const std::string& destPath, std::string& error) {
+    sqlite3* source = nullptr;
+    if (sqlite3_open_v2(snapshotPath.c_str(), &source, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+        error = sqlite3_errmsg(source);
+        sqlite3_close(source);
+        return false;
+    }
+    sqlite3_stmt* stmt;
+    std::string check;
+    if (sqlite3_prepare_v2(source, "PRAGMA quick_check;", -1, &stmt, nullptr) == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW) {
+        check = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+    }
+    sqlite3_finalize(stmt);
+    if (check != "ok") {
+        error = check.empty() ? sqlite3_errmsg(source) : check;
+        sqlite3_close(source);
+        return false;
+    }
+
+    sqlite3* dest = nullptr;
+    bool ok = false;
+    if (sqlite3_open(destPath.c_str(), &dest) == SQLITE_OK) {
+        if (sqlite3_backup* backup = sqlite3_backup_init(dest, "main", source, "main")) {
+            int rc = sqlite3_backup_step(backup, -1);
+            sqlite3_backup_finish(backup);
+            ok = rc == SQLITE_DONE;
+            if (!ok) error = sqlite3_errstr(rc);
+        } else {
+            error = sqlite3_errmsg(dest);
+        }
+    } else {
+        error = sqlite3_errmsg(dest);
+    }
+    sqlite3_close(dest);
+    sqlite3_close(source);
+    return ok;
+}
+
+// Snapshot directories hold nothing but the database files, so removing
+// those and then the directory is enough
+static void removeSnapshotDir(const std::string& path) {
+    if (DIR* handle = opendir(path.c_str())) {
+        while (dirent* entry = readdir(handle)) {
+            std::string name = entry->d_name;
+            if (name != "." && name != "..") std::remove((path + "/" + name).c_str());
+        }
+        closedir(handle);
+    }
+    rmdir(path.c_str());
+}
+
+static bool isSnapshotId(const std::string& name) {
+    return name.size() >= 15 && std::isdigit(static_cast<unsigned char>(name[0])) &&
+           name.find(".partial") == std::string::npos;
+}
+
+BackupScheduler::BackupScheduler(std::string directory, size_t keep, SnapshotFn snapshot)
+    : directory(std::move(directory)), keep(keep), snapshot(std::move(snapshot)) {
+    mkdir(this->directory.c_str(), 0755);
+    // Left behind by a run that was cut short
+    if (DIR* handle = opendir(this->directory.c_str())) {
+        std::vector<std::string> partial;
+        while (dirent* entry = readdir(handle)) {
+            std::string name = entry->d_name;
+            if (name.find(".partial") != std::string::npos) partial.push_back(name);
+        }
+        closedir(handle);
+        for (const auto& name : partial) removeSnapshotDir(this->directory + "/" + name);
+    }
+}
+
+BackupScheduler::~BackupScheduler() {
+    stop();
+}
+
+void BackupScheduler::start(std::chrono::minutes interval) {
+    if (interval.count() <= 0 || worker.joinable()) return;
+    worker = std::thread([this, interval] {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!wake.wait_for(lock, interval, [this] { return stopping; })) {
+            lock.unlock();
+            snapshotNow();
+            lock.lock();
+        }
+    });
+    logInfo("Scheduled backups").field("dir", directory).field("every_minutes", static_cast<long long>(interval.count()))
+        .field("keep", keep);
+}
+
+void BackupScheduler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    if (worker.joinable()) worker.join();
+}
+
+std::string BackupScheduler::snapshotNow() {
+    std::lock_guard<std::mutex> run(runMutex);
+
+    std::time_t now = std::time(nullptr);
+    std::tm tm_local;
+    localtime_r(&now, &tm_local);
+    char stamp[16];
+    std::strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &tm_local);
+    std::string id = stamp;
+    struct stat st;
+    for (int n = 2; stat((directory + "/" + id).c_str(), &st) == 0; ++n) {
+        id = std::string(stamp) + "-" + std::to_string(n);
+    }
+
+    std::string partial = directory + "/" + id + ".partial";
+    std::vector<BackupStats> stats;
+    bool ok = mkdir(partial.c_str(), 0755) == 0;
+    if (ok) {
+        stats = snapshot(partial);
+        ok = !stats.empty() && std::all_of(stats.begin(), stats.end(), [](const BackupStats& s) { return s.ok; });
+    }
+    if (ok) ok = std::rename(partial.c_str(), (directory + "/" + id).c_str()) == 0;
+    if (!ok) removeSnapshotDir(partial);
+    Metrics::add(Metrics::series(MetricType::Counter, "backup_snapshots_total", ok ? "result=\"ok\"" : "result=\"failed\""));
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        lastId = ok ? id : "";
+        last = stats;
+    }
+    if (!ok) {
+        logError("Snapshot failed").field("dir", directory);
+        return "";
+    }
+    prune();
+    return id;
+}
+
+void BackupScheduler::prune() {
+    std::vector<SnapshotInfo> snapshots = list();
+    for (size_t i = 0; i + keep < snapshots.size(); ++i) {
+        removeSnapshotDir(directory + "/" + snapshots[i].id);
+        logInfo("Snapshot expired").field("id", snapshots[i].id);
+    }
+}
+
+std::vector<SnapshotInfo> BackupScheduler::list() const {
+    std::vector<SnapshotInfo> snapshots;
+    DIR* handle = opendir(directory.c_str());
+    if (!handle) return snapshots;
+    while (dirent* entry = readdir(handle)) {
+        std::string name = entry->d_name;
+        if (!isSnapshotId(name)) continue;
+        SnapshotInfo info{name, 0};
+        std::string path = directory + "/" + name;
+        if (DIR* files = opendir(path.c_str())) {
+            while (dirent* file = readdir(files)) {
+                struct stat st;
+                if (file->d_name[0] != '.' && stat((path + "/" + file->d_name).c_str(), &st) == 0) info.bytes += st.st_size;
+            }
+            closedir(files);
+        }
+        snapshots.push_back(std::move(info));
+    }
+    closedir(handle);
+    // Ids are timestamps, so name order is age order
+    std::sort(snapshots.begin(), snapshots.end(), [](const SnapshotInfo& a, const SnapshotInfo& b) { return a.id < b.id; });
+    return snapshots;
+}
+
+std::pair<std::string, std::vector<BackupStats>> BackupScheduler::lastRun() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return {lastId, last};
+}
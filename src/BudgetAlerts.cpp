@@ -0,0 +1,167 @@
+#include "BudgetAlerts.h"
+#include <ctime>
+
+const char* alertRuleName(AlertRule rule) {
+    switch (rule) {
+    case AlertRule::MonthLimit: return "month_limit";
+    case AlertRule::CategoryLimit: return "category_limit";
+    default: return "projected_overspend";
+    }
+}
+
+const char* alertLevelName(AlertLevel level) {
+    switch (level) {
+    case AlertLevel::Ok: return "ok";
+    case AlertLevel::Warning: return "warning";
+    default: return "exceeded";
+    }
+}
+
+static AlertLevel levelFor(double spent, double limit) {
+    if (limit <= 0) return AlertLevel::Ok;
+    if (spent >= limit) return AlertLevel::Exceeded;
+    if (spent >= limit * BudgetAlerts::WARNING_FRACTION) return AlertLevel::Warning;
+    return AlertLevel::Ok;
+}
+
+// Month total extrapolated linearly from the days elapsed so far
+static double projectMonth(double spent) {
+    std::time_t now = std::time(nullptr);
+    std::tm tm_local;
+    localtime_r(&now, &tm_local);
+    static const int DAYS_IN_MONTH[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    int year = tm_local.tm_year + 1900;
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    int days = DAYS_IN_MONTH[tm_local.tm_mon] + (tm_local.tm_mon == 1 && leap ? 1 : 0);
+    return spent / tm_local.tm_mday * days;
+}
+
+void BudgetAlerts::evaluate(Rule& rule, AlertRule kind, double spent, std::vector<BudgetAlert>& raised) {
+    AlertLevel level = levelFor(spent, rule.limit);
+    // A projection is only ever a warning; going over for real is MonthLimit's job
+    if (kind == AlertRule::ProjectedOverspend) {
+        level = level == AlertLevel::Exceeded ? AlertLevel::Warning : AlertLevel::Ok;
+    }
+    if (level > rule.level) {
+        std::time_t now = std::time(nullptr);
+        std::tm tm_local;
+        localtime_r(&now, &tm_local);
+        char stamp[20];
+        std::strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &tm_local);
+        BudgetAlert alert{nextId++, stamp, kind, rule.subject, level, spent, rule.limit};
+        alerts.push_back(alert);
+        if (alerts.size() > MAX_ALERTS) alerts.pop_front();
+        raised.push_back(std::move(alert));
+    }
+    rule.level = level;
+}
+
+void BudgetAlerts::evaluateMonth(std::vector<BudgetAlert>& raised) {
+    evaluate(monthRule, AlertRule::MonthLimit, monthTotal, raised);
+    evaluate(projectedRule, AlertRule::ProjectedOverspend, projectMonth(monthTotal), raised);
+}
+
+void BudgetAlerts::publish(const std::vector<BudgetAlert>& raised) {
+    if (raised.empty()) return;
+    std::vector<std::function<void(const BudgetAlert&)>> targets;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        targets = listeners;
+    }
+    for (const auto& alert : raised) {
+        for (const auto& listener : targets) listener(alert);
+    }
+}
+
+void BudgetAlerts::load(const std::string& monthYear, double monthLimit, double spent,
+                        const std::unordered_map<int, double>& spentByCategory,
+                        const std::unordered_map<int, std::pair<std::string, double>>& categoryLimits) {
+    std::lock_guard<std::mutex> lock(mutex);
+    monthTotal = spent;
+    categoryTotals = spentByCategory;
+    monthRule = {monthYear, monthLimit, levelFor(spent, monthLimit)};
+    projectedRule = {monthYear, monthLimit, AlertLevel::Ok};
+    std::vector<BudgetAlert> ignored;
+    evaluate(projectedRule, AlertRule::ProjectedOverspend, projectMonth(spent), ignored);
+    categoryRules.clear();
+    for (const auto& entry : categoryLimits) {
+        auto total = categoryTotals.find(entry.first);
+        double categorySpent = total == categoryTotals.end() ? 0.0 : total->second;
+        categoryRules[entry.first] = {entry.second.first, entry.second.second, levelFor(categorySpent, entry.second.second)};
+    }
+    alerts.clear();
+    nextId = 1;
+}
+
+void BudgetAlerts::record(int categoryId, double amount) {
+    replace(categoryId, 0.0, categoryId, amount);
+}
+
+void BudgetAlerts::replace(int oldCategoryId, double oldAmount, int categoryId, double amount) {
+    std::vector<BudgetAlert> raised;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        monthTotal += amount - oldAmount;
+        categoryTotals[oldCategoryId] -= oldAmount;
+        categoryTotals[categoryId] += amount;
+        evaluateMonth(raised);
+        for (int id : {oldCategoryId, categoryId}) {
+            auto rule = categoryRules.find(id);
+            if (rule != categoryRules.end()) evaluate(rule->second, AlertRule::CategoryLimit, categoryTotals[id], raised);
+            if (oldCategoryId == categoryId) break;
+        }
+    }
+    publish(raised);
+}
+
+void BudgetAlerts::setMonthLimit(double limit) {
+    std::vector<BudgetAlert> raised;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        monthRule.limit = limit;
+        projectedRule.limit = limit;
+        evaluateMonth(raised);
+    }
+    publish(raised);
+}
+
+void BudgetAlerts::setCategoryLimit(int categoryId, const std::string& name, double limit) {
+    std::vector<BudgetAlert> raised;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (limit <= 0) {
+            categoryRules.erase(categoryId);
+            return;
+        }
+        Rule& rule = categoryRules[categoryId];
+        rule.subject = name;
+        rule.limit = limit;
+        evaluate(rule, AlertRule::CategoryLimit, categoryTotals[categoryId], raised);
+    }
+    publish(raised);
+}
+
+double BudgetAlerts::spent() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return monthTotal;
+}
+
+double BudgetAlerts::categorySpent(int categoryId) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto total = categoryTotals.find(categoryId);
+    return total == categoryTotals.end() ? 0.0 : total->second;
+}
+
+std::vector<BudgetAlert> BudgetAlerts::since(uint64_t afterId) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<BudgetAlert> result;
+    for (const auto& alert : alerts) {
+        if (alert.id > afterId) result.push_back(alert);
+    }
+    return result;
+}
+
+void BudgetAlerts::subscribe(std::function<void(const BudgetAlert&)> listener) {
+    std::lock_guard<std::mutex> lock(mutex);
+    listeners.push_back(std::move(listener));
+}
@@ -0,0 +1,46 @@
+#include "ChangeFeed.h"
+
+uint64_t ChangeFeed::publish(const std::string& type, const std::string& fields) {
+    std::lock_guard<std::mutex> lock(mutex);
+    uint64_t seq = nextSeq++;
+    std::string event = "{\"seq\": " + std::to_string(seq) + ", \"type\": \"" + type + "\"";
+    if (!fields.empty()) event += ", " + fields;
+    event += "}";
+
+    for (const auto& entry : subscribers) entry.second(event);
+    history.emplace_back(seq, std::move(event));
+    if (history.size() > HISTORY_SIZE) history.pop_front();
+    return seq;
+}
+
+uint64_t ChangeFeed::subscribe(Sink send, uint64_t sinceSeq) {
+    std::lock_guard<std::mutex> lock(mutex);
+    uint64_t last = nextSeq - 1;
+    uint64_t oldest = history.empty() ? nextSeq : history.front().first;
+    if (sinceSeq != UINT64_MAX && (sinceSeq > last || sinceSeq + 1 < oldest)) {
+        // Ahead of us (the server restarted) or behind what is retained
+        send("{\"seq\": " + std::to_string(last) + ", \"type\": \"resync\"}");
+    } else {
+        for (const auto& event : history) {
+            if (event.first > sinceSeq) send(event.second);
+        }
+    }
+    uint64_t handle = nextSubscriber++;
+    subscribers.emplace(handle, std::move(send));
+    return handle;
+}
+
+void ChangeFeed::unsubscribe(uint64_t handle) {
+    std::lock_guard<std::mutex> lock(mutex);
+    subscribers.erase(handle);
+}
+
+size_t ChangeFeed::subscriberCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return subscribers.size();
+}
+
+uint64_t ChangeFeed::lastSeq() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return nextSeq - 1;
+}
@@ -0,0 +1,151 @@
+#include "Compression.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <vector>
+#include <zlib.h>
+#ifdef EXPENSE_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+static std::string trim(const std::string& s) {
+    size_t begin = s.find_first_not_of(" \t");
+    if (begin == std::string::npos) return "";
+    size_t end = s.find_last_not_of(" \t");
+    return s.substr(begin, end - begin + 1);
+}
+
+ContentEncoding negotiateEncoding(const std::string& acceptEncoding) {
+    // q value per encoding, -1 when not mentioned
+    double q[4] = {-1, -1, -1, -1};
+    double wildcard = -1;
+    size_t pos = 0;
+    while (pos <= acceptEncoding.size()) {
+        size_t comma = acceptEncoding.find(',', pos);
+        if (comma == std::string::npos) comma = acceptEncoding.size();
+        std::string item = acceptEncoding.substr(pos, comma - pos);
+        pos = comma + 1;
+
+        double value = 1.0;
+        size_t semi = item.find(';');
+        if (semi != std::string::npos) {
+            std::string param = trim(item.substr(semi + 1));
+            if (param.size() > 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=') {
+                value = std::atof(param.c_str() + 2);
+            }
+            item = item.substr(0, semi);
+        }
+        std::string name = trim(item);
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+        if (name == "gzip" || name == "x-gzip") q[static_cast<int>(ContentEncoding::Gzip)] = value;
+        else if (name == "deflate") q[static_cast<int>(ContentEncoding::Deflate)] = value;
+        else if (name == "zstd") q[static_cast<int>(ContentEncoding::Zstd)] = value;
+        else if (name == "*") wildcard = value;
+    }
+
+    ContentEncoding best = ContentEncoding::Identity;
+    double bestQ = 0.0;
+    const ContentEncoding preference[] = {ContentEncoding::Zstd, ContentEncoding::Gzip, ContentEncoding::Deflate};
+    for (ContentEncoding encoding : preference) {
+#ifndef EXPENSE_HAVE_ZSTD
+        if (encoding == ContentEncoding::Zstd) continue;
+#endif
+        double value = q[static_cast<int>(encoding)];
+        if (value < 0) value = wildcard;
+        if (value > bestQ) {
+            best = encoding;
+            bestQ = value;
+        }
+    }
+    return best;
+}
+
+const char* encodingName(ContentEncoding encoding) {
+    switch (encoding) {
+    case ContentEncoding::Gzip: return "gzip";
+    case ContentEncoding::Deflate: return "deflate";
+    case ContentEncoding::Zstd: return "zstd";
+    default: return "";
+    }
+}
+
+bool isCompressible(const std::string& contentType) {
+    return contentType.compare(0, 5, "text/") == 0 || contentType.find("json") != std::string::npos ||
+           contentType.find("svg") != std::string::npos || contentType.find("javascript") != std::string::npos;
+}
+
+int compressionLevel(const std::string& contentType, ContentEncoding encoding) {
+    bool svg = contentType.find("svg") != std::string::npos;
+    if (encoding == ContentEncoding::Zstd) return svg ? 12 : 3;
+    // zlib: 1 fastest .. 9 smallest
+    return svg ? 9 : 5;
+}
+
+// One deflate stream per thread, encoding and level, reset between uses so the
+// ~300 KB of zlib state isn't reallocated for every response
+static z_stream* zlibStream(ContentEncoding encoding, int level) {
+    struct Streams {
+        std::unique_ptr<z_stream> streams[2][10];
+        ~Streams() {
+            for (auto& row : streams)
+                for (auto& s : row)
+                    if (s) deflateEnd(s.get());
+        }
+    };
+    thread_local Streams cache;
+    int kind = encoding == ContentEncoding::Gzip ? 1 : 0;
+    std::unique_ptr<z_stream>& slot = cache.streams[kind][level];
+    if (!slot) {
+        slot.reset(new z_stream());
+        // windowBits 15 + 16 selects the gzip wrapper, plain 15 the zlib
+        // wrapper that HTTP calls "deflate"
+        if (deflateInit2(slot.get(), level, Z_DEFLATED, kind ? 15 + 16 : 15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            slot.reset();
+            return nullptr;
+        }
+    } else {
+        deflateReset(slot.get());
+    }
+    return slot.get();
+}
+
+bool compressBody(const std::string& body, ContentEncoding encoding, int level, std::string& out) {
+    if (encoding == ContentEncoding::Gzip || encoding == ContentEncoding::Deflate) {
+        level = std::max(1, std::min(9, level));
+        z_stream* zs = zlibStream(encoding, level);
+        if (!zs) return false;
+        out.resize(deflateBound(zs, body.size()) + 32);
+        zs->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(body.data()));
+        zs->avail_in = static_cast<uInt>(body.size());
+        zs->next_out = reinterpret_cast<Bytef*>(&out[0]);
+        zs->avail_out = static_cast<uInt>(out.size());
+        if (deflate(zs, Z_FINISH) != Z_STREAM_END) return false;
+        out.resize(zs->total_out);
+        return true;
+    }
+#ifdef EXPENSE_HAVE_ZSTD
+    if (encoding == ContentEncoding::Zstd) {
+        out.resize(ZSTD_compressBound(body.size()));
+        size_t n = ZSTD_compress(&out[0], out.size(), body.data(), body.size(), level);
+        if (ZSTD_isError(n)) return false;
+        out.resize(n);
+        return true;
+    }
+#endif
+    return false;
+}
+
+// --- PrecompressedBody ---
+
+PrecompressedBody::PrecompressedBody(std::string body, std::string contentType)
+    : body(std::move(body)), contentType(std::move(contentType)) {}
+
+const std::string* PrecompressedBody::get(ContentEncoding encoding) const {
+    int index = static_cast<int>(encoding);
+    if (encoding == ContentEncoding::Identity || body.size() < COMPRESSION_MIN_BYTES) return nullptr;
+    std::call_once(once[index], [&] {
+        usable[index] = compressBody(body, encoding, compressionLevel(contentType, encoding), encoded[index]) &&
+                        encoded[index].size() < body.size();
+    });
+    return usable[index] ? &encoded[index] : nullptr;
+}
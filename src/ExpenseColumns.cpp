@@ -0,0 +1,294 @@
+#include "ExpenseColumns.h"
+#include "AggregateKernels.h"
+#include "helper.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <mutex>
+
+uint16_t ExpenseColumns::internItem(const std::string& spentOn) {
+    auto it = itemCodes.find(spentOn);
+    if (it != itemCodes.end()) return it->second;
+    if (itemNames.size() > std::numeric_limits<uint16_t>::max()) {
+        overflowed = true;
+        return 0;
+    }
+    uint16_t code = static_cast<uint16_t>(itemNames.size());
+    itemNames.push_back(spentOn);
+    itemCodes.emplace(spentOn, code);
+    return code;
+}
+
+uint16_t ExpenseColumns::narrowId(int id, bool& overflowed) {
+    if (id < 0 || id > std::numeric_limits<uint16_t>::max()) {
+        overflowed = true;
+        return 0;
+    }
+    return static_cast<uint16_t>(id);
+}
+
+void ExpenseColumns::addSortedPrice(int32_t month, double price) {
+    sortedPrices[month].add(price);
+}
+
+void ExpenseColumns::eraseSortedPrice(int32_t month, double price) {
+    auto it = sortedPrices.find(month);
+    if (it == sortedPrices.end()) return;
+    it->second.erase(price);
+    if (it->second.empty()) sortedPrices.erase(it);
+}
+
+void ExpenseColumns::addToBucket(int32_t month, uint16_t item, int64_t key, double price) {
+    ItemBucket& bucket = itemBuckets[month][item];
+    bucket.total += price;
+    bucket.rows.push_back(key);
+    if (bucket.stale) return; // the rebuild will pick the row up
+    bucket.min = bucket.rows.size() == 1 ? price : std::min(bucket.min, price);
+    bucket.max = bucket.rows.size() == 1 ? price : std::max(bucket.max, price);
+    bucket.sketch.add(price);
+}
+
+void ExpenseColumns::removeFromBucket(int32_t month, uint16_t item, int64_t key, double price) {
+    auto monthIt = itemBuckets.find(month);
+    if (monthIt == itemBuckets.end()) return;
+    auto it = monthIt->second.find(item);
+    if (it == monthIt->second.end()) return;
+    ItemBucket& bucket = it->second;
+    auto row = std::find(bucket.rows.begin(), bucket.rows.end(), key);
+    if (row == bucket.rows.end()) return;
+    *row = bucket.rows.back();
+    bucket.rows.pop_back();
+    if (bucket.rows.empty()) {
+        monthIt->second.erase(it);
+        if (monthIt->second.empty()) itemBuckets.erase(monthIt);
+        return;
+    }
+    bucket.total -= price;
+    bucket.stale = true;
+}
+
+void ExpenseColumns::refreshBucket(ItemBucket& bucket) const {
+    if (!bucket.stale) return;
+    // total is exact already, and itemAggregates reads it without bucketMutex
+    bucket.sketch = QuantileSketch();
+    for (size_t i = 0; i < bucket.rows.size(); ++i) {
+        double price = prices[positions.at(bucket.rows[i])];
+        bucket.min = i == 0 ? price : std::min(bucket.min, price);
+        bucket.max = i == 0 ? price : std::max(bucket.max, price);
+        bucket.sketch.add(price);
+    }
+    bucket.stale = false;
+}
+
+void ExpenseColumns::clear() {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    months.clear();
+    dates.clear();
+    prices.clear();
+    items.clear();
+    categories.clear();
+    modes.clear();
+    keys.clear();
+    positions.clear();
+    itemNames.clear();
+    itemCodes.clear();
+    sortedPrices.clear();
+    itemBuckets.clear();
+    spend.clear();
+    overflowed = false;
+}
+
+void ExpenseColumns::upsert(int month, int rowid, const std::string& dayMonthYear, const std::string& spentOn,
+                            double price, int categoryId, int modeOfPaymentId) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    int64_t key = makeKey(month, rowid);
+    auto it = positions.find(key);
+    size_t row;
+    if (it != positions.end()) {
+        row = it->second;
+        eraseSortedPrice(months[row], prices[row]);
+        removeFromBucket(months[row], items[row], key, prices[row]);
+        spend.add(dates[row], -prices[row]);
+    } else {
+        row = keys.size();
+        positions.emplace(key, row);
+        months.push_back(month);
+        dates.push_back(0);
+        prices.push_back(0.0);
+        items.push_back(0);
+        categories.push_back(0);
+        modes.push_back(0);
+        keys.push_back(key);
+    }
+    dates[row] = parseExpenseDate(dayMonthYear);
+    prices[row] = price;
+    addSortedPrice(month, price);
+    items[row] = internItem(spentOn);
+    categories[row] = narrowId(categoryId, overflowed);
+    modes[row] = narrowId(modeOfPaymentId, overflowed);
+    addToBucket(month, items[row], key, price);
+    spend.add(dates[row], price);
+}
+
+void ExpenseColumns::update(int month, int rowid, const std::optional<std::string>& dayMonthYear,
+                            const std::optional<std::string>& spentOn, const std::optional<double>& price,
+                            const std::optional<int>& categoryId, const std::optional<int>& modeOfPaymentId) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    auto it = positions.find(makeKey(month, rowid));
+    if (it == positions.end()) return;
+    size_t row = it->second;
+    if (dayMonthYear || price) spend.add(dates[row], -prices[row]);
+    if (dayMonthYear) dates[row] = parseExpenseDate(*dayMonthYear);
+    if (spentOn || price) removeFromBucket(months[row], items[row], keys[row], prices[row]);
+    if (spentOn) items[row] = internItem(*spentOn);
+    if (price) {
+        eraseSortedPrice(months[row], prices[row]);
+        prices[row] = *price;
+        addSortedPrice(months[row], *price);
+    }
+    if (spentOn || price) addToBucket(months[row], items[row], keys[row], prices[row]);
+    if (categoryId) categories[row] = narrowId(*categoryId, overflowed);
+    if (modeOfPaymentId) modes[row] = narrowId(*modeOfPaymentId, overflowed);
+    if (dayMonthYear || price) spend.add(dates[row], prices[row]);
+}
+
+void ExpenseColumns::remove(int month, int rowid) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    auto it = positions.find(makeKey(month, rowid));
+    if (it == positions.end()) return;
+
+    // Move the last row into the hole so the columns stay dense
+    size_t row = it->second;
+    size_t last = keys.size() - 1;
+    positions.erase(it);
+    eraseSortedPrice(months[row], prices[row]);
+    removeFromBucket(months[row], items[row], keys[row], prices[row]);
+    spend.add(dates[row], -prices[row]);
+    if (row != last) {
+        months[row] = months[last];
+        dates[row] = dates[last];
+        prices[row] = prices[last];
+        items[row] = items[last];
+        categories[row] = categories[last];
+        modes[row] = modes[last];
+        keys[row] = keys[last];
+        positions[keys[row]] = row;
+    }
+    months.pop_back();
+    dates.pop_back();
+    prices.pop_back();
+    items.pop_back();
+    categories.pop_back();
+    modes.pop_back();
+    keys.pop_back();
+}
+
+bool ExpenseColumns::usable() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return !overflowed;
+}
+
+size_t ExpenseColumns::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return keys.size();
+}
+
+size_t ExpenseColumns::memoryBytes() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    size_t bytes = months.capacity() * sizeof(int32_t) + dates.capacity() * sizeof(int32_t) +
+                   prices.capacity() * sizeof(double) + items.capacity() * sizeof(uint16_t) +
+                   categories.capacity() * sizeof(uint16_t) + modes.capacity() * sizeof(uint16_t) +
+                   keys.capacity() * sizeof(int64_t);
+    for (const auto& month : sortedPrices) bytes += month.second.memoryBytes() + sizeof(month) + 2 * sizeof(void*);
+    {
+        std::lock_guard<std::mutex> bucketLock(bucketMutex);
+        for (const auto& month : itemBuckets) {
+            for (const auto& entry : month.second) {
+                bytes += sizeof(entry) + 2 * sizeof(void*) + entry.second.rows.capacity() * sizeof(int64_t) +
+                         entry.second.sketch.memoryBytes();
+            }
+        }
+    }
+    // Rough per-node cost of the hash maps
+    bytes += positions.size() * (sizeof(int64_t) + sizeof(size_t) + 2 * sizeof(void*));
+    for (const auto& name : itemNames) {
+        bytes += sizeof(std::string) + name.capacity() + sizeof(std::string) + sizeof(uint16_t) + 2 * sizeof(void*);
+    }
+    return bytes;
+}
+
+double ExpenseColumns::totalForMonth(int month) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return activeKernels().sumInRange(prices.data(), months.data(), prices.size(), month, month);
+}
+
+std::array<double, 12> ExpenseColumns::monthlyTotals(int year) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    std::array<double, 12> totals{};
+    // YYYYMM keys for one year are contiguous, so the month is the bucket
+    activeKernels().histogram(prices.data(), months.data(), prices.size(), year * 100 + 1, totals.size(), totals.data());
+    return totals;
+}
+
+std::vector<ItemAggregate> ExpenseColumns::itemAggregates(int month) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    // Counts and sums never go stale, so nothing is rebuilt here
+    std::vector<ItemAggregate> result;
+    auto monthIt = itemBuckets.find(month);
+    if (monthIt == itemBuckets.end()) return result;
+    // Ties go to the item seen first, as they did when this scanned the rows
+    std::vector<std::pair<uint16_t, const ItemBucket*>> ordered;
+    for (const auto& entry : monthIt->second) ordered.push_back({entry.first, &entry.second});
+    std::sort(ordered.begin(), ordered.end(), [](const auto& a, const auto& b) {
+        size_t countA = a.second->rows.size(), countB = b.second->rows.size();
+        return countA != countB ? countA > countB : a.first < b.first;
+    });
+    for (const auto& entry : ordered) {
+        result.push_back({itemNames[entry.first], entry.second->total, static_cast<int>(entry.second->rows.size())});
+    }
+    return result;
+}
+
+ItemStats ExpenseColumns::itemStats(const std::string& spentOn, int fromMonth, int toMonth) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    std::lock_guard<std::mutex> bucketLock(bucketMutex);
+    ItemStats stats;
+    stats.spent_on = spentOn;
+    auto code = itemCodes.find(spentOn);
+    if (code == itemCodes.end()) return stats;
+
+    QuantileSketch window;
+    for (auto& month : itemBuckets) {
+        if (month.first < fromMonth || month.first > toMonth) continue;
+        auto it = month.second.find(code->second);
+        if (it == month.second.end()) continue;
+        ItemBucket& bucket = it->second;
+        refreshBucket(bucket);
+        stats.min = stats.count == 0 ? bucket.min : std::min(stats.min, bucket.min);
+        stats.max = stats.count == 0 ? bucket.max : std::max(stats.max, bucket.max);
+        stats.count += static_cast<int>(bucket.rows.size());
+        stats.total += bucket.total;
+        window.merge(bucket.sketch);
+    }
+    if (stats.count == 0) return stats;
+    window.compress();
+    stats.p50 = window.quantile(0.5, stats.min, stats.max);
+    stats.p90 = window.quantile(0.9, stats.min, stats.max);
+    return stats;
+}
+
+PriceDistribution ExpenseColumns::priceQuantiles(int month, const std::vector<double>& quantiles) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    PriceDistribution result;
+    auto it = sortedPrices.find(month);
+    if (it == sortedPrices.end()) return result;
+    const PriceRanks& sorted = it->second;
+    result.count = sorted.size();
+    for (double q : quantiles) {
+        // Nearest rank: the smallest price with at least q of the month at or below it
+        size_t rank = static_cast<size_t>(std::ceil(q * sorted.size()));
+        rank = std::min(std::max<size_t>(rank, 1), sorted.size());
+        result.prices.push_back(sorted.select(rank - 1));
+    }
+    return result;
+}
@@ -1,6 +1,8 @@
 #include<optional>
 #include "helper.h"
 #include "FinanceDB.h"
+#include "Logger.h"
+#include "Metrics.h"
 #include<vector>
 #include<queue>
 #include <iostream>
@@ -10,6 +12,11 @@
 #include <numeric>
 #include <ctime>
 #include <functional>
+#include <future>
+#include <cstdio>
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
 
 // Helper function to get current month and year string MM_YYYY
 std::string getCurrentYearMonth() {
@@ -33,45 +40,265 @@ std::string getCurrentDayMonthYear() {
     return ss.str();
 }
 
+// PRAGMA user_version of a database whose schema is current. Bump it with
+// every schema change and add the upgrade step to the matching init function,
+// so databases that are already up to date skip all DDL on startup.
+static const int MAIN_SCHEMA_VERSION = 2; // 2: CategoryLimits
+static const int DETAILED_SCHEMA_VERSION = 4; // 1: dictionary ids, 2: Price index, 3: ChangeLog, 4: FieldClock/SyncApplied
+
+// The change log is handled in segments of CHANGE_LOG_SEGMENT seqs. The newest
+// CHANGE_LOG_HOT_SEGMENTS are left as written; older ones are compacted, and
+// at most CHANGE_LOG_MAX_ENTRIES entries are kept in all.
+static const long long CHANGE_LOG_SEGMENT = 4096;
+static const long long CHANGE_LOG_HOT_SEGMENTS = 2;
+static const long long CHANGE_LOG_MAX_ENTRIES = 16 * CHANGE_LOG_SEGMENT;
+
+// How long a synced mutation id is remembered; a client retrying a batch
+// later than this may apply it twice
+static const long long SYNC_REPLAY_WINDOW_MS = 30LL * 24 * 60 * 60 * 1000;
+
+// Current time in ms since the epoch, as an SQL expression
+static const std::string NOW_MS_SQL = "CAST((julianday('now') - 2440587.5) * 86400000 AS INTEGER)";
+
+// Read-only connections kept open to Detailed.db, i.e. how many report
+// queries can run at once next to the writer
+static const size_t READ_POOL_SIZE = 4;
+
+// Columns of a month table, the same in Detailed.db and Archive.db
+static const std::string MONTH_TABLE_COLUMNS = "("
+                                               "day_month_year TEXT PRIMARY KEY,"
+                                               "SpentOn TEXT NOT NULL,"
+                                               "Price REAL NOT NULL,"
+                                               "CategoryId INTEGER,"
+                                               "ModeOfPaymentId INTEGER,"
+                                               "Priority INTEGER DEFAULT 0)";
+
+// `name` in the same directory as `path`
+static std::string siblingPath(const std::string& path, const std::string& name) {
+    size_t slash = path.rfind('/');
+    return slash == std::string::npos ? name : path.substr(0, slash + 1) + name;
+}
+
+static bool attachDatabase(sqlite3* db, const std::string& path, const char* schema) {
+    sqlite3_stmt* stmt;
+    bool attached = false;
+    if (sqlite3_prepare_v2(db, (std::string("ATTACH DATABASE ? AS ") + schema + ";").c_str(), -1, &stmt, 0) == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, path.c_str(), -1, SQLITE_STATIC);
+        attached = sqlite3_step(stmt) == SQLITE_DONE;
+    }
+    sqlite3_finalize(stmt);
+    return attached;
+}
+
+static int schemaVersion(sqlite3* db) {
+    int version = 0;
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "PRAGMA user_version;", -1, &stmt, 0) == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW) {
+        version = sqlite3_column_int(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return version;
+}
+
 // constructor
 FinanceDB::FinanceDB(const std::string& mainDbPath, const std::string& detailedDbPath)
     : mainDB(nullptr), detailedDB(nullptr) {
     
     currentYearMonth = getCurrentYearMonth();
     currentTableName = "expenses_" + currentYearMonth;
+    currentMonth = tableMonth(currentTableName);
+    archivePath = siblingPath(detailedDbPath, "Archive.db");
+
+    // The two files are independent until the dictionary migration, so they
+    // are opened and initialized side by side
+    auto detailedReady = std::async(std::launch::async, [this, &detailedDbPath] { openDetailedDB(detailedDbPath); });
+    openMainDB(mainDbPath);
+    detailedReady.get();
+
+    // Upgrading old month tables resolves names through Main.db, so it waits
+    // for both connections; once done the version marks it as never needed again
+    int detailedVersion = detailedDB ? schemaVersion(detailedDB) : DETAILED_SCHEMA_VERSION;
+    if (mainDB && detailedVersion < DETAILED_SCHEMA_VERSION) {
+        bool upgraded = true;
+        for (const auto& table : listExpenseTables(false)) {
+            if (detailedVersion < 1) upgraded = migrateDictionaryColumns(table) && upgraded;
+            if (detailedVersion < 2) createPriceIndex(table);
+        }
+        if (detailedVersion < 3) createChangeLog();
+        if (detailedVersion < 4) createSyncTables();
+        // A month that couldn't be migrated keeps its names as text; the
+        // version stays behind so the next start migrates it again
+        if (upgraded) {
+            executeSQL(detailedDB, "PRAGMA user_version = " + std::to_string(DETAILED_SCHEMA_VERSION) + ";");
+        } else {
+            logError("Detailed DB upgrade incomplete, will retry on next start").field("version", detailedVersion);
+        }
+    }
+    // The triggers write to ChangeLog and FieldClock, which the upgrade above
+    // creates. Every live month is logged, not just the current one, so
+    // /changes misses no write whichever month it lands in.
+    if (isOpen()) {
+        for (const auto& table : listExpenseTables(false)) {
+            if (tableMonth(table) != 0) createChangeTriggers(table);
+        }
+        createClockTriggers(currentTableName);
+        attachArchive();
+        openReadPool(detailedDbPath);
+    }
+    loadBudget();
+}
 
-    if (sqlite3_open(mainDbPath.c_str(), &mainDB)) {
-        std::cerr << "Error opening Main DB: " << sqlite3_errmsg(mainDB) << std::endl;
+void FinanceDB::openMainDB(const std::string& path) {
+    if (sqlite3_open(path.c_str(), &mainDB)) {
+        logError("Error opening Main DB").field("error", sqlite3_errmsg(mainDB));
+        sqlite3_close(mainDB);
         mainDB = nullptr;
-    } else {
-        std::cout << "Main DB opened successfully." << std::endl;
-        initMainDB();
+        return;
     }
+    logInfo("Main DB opened successfully.");
+    mainTrace = {this, "main", Metrics::series(MetricType::Histogram, "sqlite_prepare_duration_seconds", "db=\"main\""),
+                 Metrics::series(MetricType::Histogram, "sqlite_statement_duration_seconds", "db=\"main\"")};
+    sqlite3_trace_v2(mainDB, SQLITE_TRACE_STMT | SQLITE_TRACE_PROFILE, traceStatement, &mainTrace);
+    initMainDB();
+    categoriesCache.refresh([this] { return queryNames("Categories"); });
+    modesCache.refresh([this] { return queryNames("ModeOfPayment"); });
+}
 
-    if (sqlite3_open(detailedDbPath.c_str(), &detailedDB)) {
-        std::cerr << "Error opening Detailed DB: " << sqlite3_errmsg(detailedDB) << std::endl;
+void FinanceDB::openDetailedDB(const std::string& path) {
+    if (sqlite3_open(path.c_str(), &detailedDB)) {
+        logError("Error opening Detailed DB").field("error", sqlite3_errmsg(detailedDB));
+        sqlite3_close(detailedDB);
         detailedDB = nullptr;
-    } else {
-        std::cout << "Detailed DB opened successfully." << std::endl;
-        initDetailedDB();
+        return;
     }
+    logInfo("Detailed DB opened successfully.");
+    detailedTrace = {this, "detailed", Metrics::series(MetricType::Histogram, "sqlite_prepare_duration_seconds", "db=\"detailed\""),
+                     Metrics::series(MetricType::Histogram, "sqlite_statement_duration_seconds", "db=\"detailed\"")};
+    sqlite3_trace_v2(detailedDB, SQLITE_TRACE_STMT | SQLITE_TRACE_PROFILE, traceStatement, &detailedTrace);
+    initDetailedDB();
+}
+
+// Readers only get their own snapshot with the file in WAL mode; in the
+// default rollback journal a long read would still block commits, so without
+// WAL every query stays on detailedDB.
+void FinanceDB::openReadPool(const std::string& path) {
+    std::string mode;
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(detailedDB, "PRAGMA journal_mode=WAL;", -1, &stmt, 0) == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW) {
+        mode = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+    }
+    sqlite3_finalize(stmt);
+    if (mode != "wal") {
+        logWarn("Detailed DB not in WAL mode, reads share the write connection").field("journal_mode", mode);
+        return;
+    }
+
+    replicaTrace = {this, "replica", Metrics::series(MetricType::Histogram, "sqlite_prepare_duration_seconds", "db=\"replica\""),
+                    Metrics::series(MetricType::Histogram, "sqlite_statement_duration_seconds", "db=\"replica\"")};
+    bool opened = readers.open(path, READ_POOL_SIZE, [this](sqlite3* db) {
+        // Only a checkpoint resetting the WAL can keep a reader waiting
+        sqlite3_busy_timeout(db, 1000);
+        sqlite3_trace_v2(db, SQLITE_TRACE_STMT | SQLITE_TRACE_PROFILE, traceStatement, &replicaTrace);
+        return !archiveAttached || attachDatabase(db, archivePath, "archive");
+    });
+    if (opened) logInfo("Read pool opened.").field("connections", READ_POOL_SIZE);
+}
+
+// Old months are moved out to Archive.db by archiveOldMonths. It is in WAL
+// mode too, so reading an archived month never waits on a move.
+void FinanceDB::attachArchive() {
+    if (!attachDatabase(detailedDB, archivePath, "archive")) {
+        logError("Failed to attach archive, old months stay in Detailed.db").field("path", archivePath)
+            .field("error", sqlite3_errmsg(detailedDB));
+        return;
+    }
+    executeSQL(detailedDB, "PRAGMA archive.journal_mode=WAL;");
+    // One row per archived month, written when its live table is dropped
+    executeSQL(detailedDB, "CREATE TABLE IF NOT EXISTS archive.ArchivedMonths ("
+                           "month INTEGER PRIMARY KEY,"
+                           "rows INTEGER NOT NULL,"
+                           "total REAL NOT NULL,"
+                           "archived_at TEXT NOT NULL DEFAULT (datetime('now')));");
+    archiveAttached = true;
 }
 
 FinanceDB::~FinanceDB() {
+    // Its worker explains plans on the connections closed below
+    profiler.reset();
+    // Before the writer: the last connection to close checkpoints the WAL and
+    // removes it, which a read-only one can't do
+    readers.close();
     if (mainDB) sqlite3_close(mainDB);
     if (detailedDB) sqlite3_close(detailedDB);
-    std::cout << "Database connections closed." << std::endl;
+    logInfo("Database connections closed.");
+}
+
+int FinanceDB::prepare(sqlite3* db, const std::string& sql, sqlite3_stmt** stmt) {
+    auto start = std::chrono::steady_clock::now();
+    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, stmt, 0);
+    const ConnectionTrace& trace = db == mainDB ? mainTrace : db == detailedDB ? detailedTrace : replicaTrace;
+    Metrics::observe(trace.prepare, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    return rc;
 }
 
-void FinanceDB::executeSQL(sqlite3* db, const std::string& sql) {
+// SQLITE_TRACE_STMT fires when a statement starts running and
+// SQLITE_TRACE_PROFILE when it finishes. SQLite's own elapsed time has only
+// millisecond resolution on most builds, so the run is timed here instead.
+// Per-row tracing would cost a callback for every row of every scan; the VM
+// step count SQLite keeps anyway stands in for the work done.
+int FinanceDB::traceStatement(unsigned type, void* context, void* stmt, void* detail) {
+    (void)detail;
+    thread_local std::unordered_map<void*, std::chrono::steady_clock::time_point> running;
+    sqlite3_stmt* s = static_cast<sqlite3_stmt*>(stmt);
+
+    if (type == SQLITE_TRACE_STMT) {
+        // The profiler's own EXPLAIN QUERY PLAN is not profiled
+        if (!sqlite3_stmt_isexplain(s)) running[stmt] = std::chrono::steady_clock::now();
+        return 0;
+    }
+    auto it = running.find(stmt);
+    if (it == running.end()) return 0;
+    const ConnectionTrace* trace = static_cast<const ConnectionTrace*>(context);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - it->second).count();
+    running.erase(it);
+    Metrics::observe(trace->statement, seconds);
+    uint64_t steps = static_cast<uint64_t>(sqlite3_stmt_status(s, SQLITE_STMTSTATUS_VM_STEP, 1));
+    if (trace->owner->profiler) trace->owner->profiler->record(trace->name, s, seconds, steps);
+    return 0;
+}
+
+void FinanceDB::enableQueryProfiler(double thresholdMs, const std::string& logPath) {
+    // Detailed.db plans come from a reader, which sees the same tables, so
+    // the writer isn't held up by them
+    profiler.reset(new QueryProfiler(thresholdMs, logPath, [this](const std::string& db, const std::string& sql) {
+        if (db == mainTrace.name) return QueryProfiler::explain(mainDB, sql.c_str());
+        ReadPool::Lease reader = readers.lease(detailedDB);
+        return QueryProfiler::explain(reader.db(), sql.c_str());
+    }));
+}
+
+std::string FinanceDB::queryProfileJson() const {
+    return profiler ? profiler->toJson() : "null";
+}
+
+void FinanceDB::resetQueryProfile() {
+    if (profiler) profiler->reset();
+}
+
+bool FinanceDB::executeSQL(sqlite3* db, const std::string& sql) {
     char* errMsg = nullptr;
     if (sqlite3_exec(db, sql.c_str(), 0, 0, &errMsg) != SQLITE_OK) { // 0 for unsucess
-        std::cerr << "SQL error: " << errMsg << std::endl;
+        logError("SQL error").field("error", errMsg);
         sqlite3_free(errMsg);
+        return false;
     }
+    return true;
 }
 
 void FinanceDB::initMainDB() {
+    int version = schemaVersion(mainDB);
+    if (version >= MAIN_SCHEMA_VERSION) return;
+
     std::string sql = "CREATE TABLE IF NOT EXISTS Overall ("
                       "month_year TEXT PRIMARY KEY,"
                       "Salary REAL NOT NULL,"
@@ -89,33 +316,332 @@ void FinanceDB::initMainDB() {
           "id INTEGER PRIMARY KEY AUTOINCREMENT,"
           "name TEXT UNIQUE NOT NULL);";
     executeSQL(mainDB, sql);
+
+    if (version < 2) {
+        sql = "CREATE TABLE IF NOT EXISTS CategoryLimits ("
+              "category_id INTEGER PRIMARY KEY,"
+              "limit_amount REAL NOT NULL);";
+        executeSQL(mainDB, sql);
+    }
+    executeSQL(mainDB, "PRAGMA user_version = " + std::to_string(MAIN_SCHEMA_VERSION) + ";");
 }
 
 void FinanceDB::initDetailedDB() {
-    std::string sql = "CREATE TABLE IF NOT EXISTS " + currentTableName + " ("
-                      "day_month_year TEXT PRIMARY KEY,"
-                      "SpentOn TEXT NOT NULL,"
-                      "Price REAL NOT NULL,"
-                      "Category TEXT,"
-                      "ModeOfPayment TEXT,"
-                      "Priority INTEGER DEFAULT 0);";
-    executeSQL(detailedDB, sql);
+    // Category and mode of payment are stored as ids into Main.db's
+    // Categories/ModeOfPayment tables and decoded through the cached dictionaries
+    executeSQL(detailedDB, "CREATE TABLE IF NOT EXISTS " + currentTableName + " " + MONTH_TABLE_COLUMNS + ";");
+    createPriceIndex(currentTableName);
+}
 
-    sql = "ALTER TABLE " + currentTableName + " ADD COLUMN ModeOfPayment TEXT;";
+// Lets ORDER BY Price ... LIMIT k walk k index entries instead of sorting the
+// whole month
+void FinanceDB::createPriceIndex(const std::string& tableName) {
+    executeSQL(detailedDB, "CREATE INDEX IF NOT EXISTS " + tableName + "_price ON " + tableName + " (Price);");
+}
+
+// Sequenced log of every change to expense rows, for incremental sync. It is
+// filled by triggers on the month tables, so an entry commits together with
+// the write it records.
+void FinanceDB::createChangeLog() {
+    std::string sql = "CREATE TABLE IF NOT EXISTS ChangeLog ("
+                      "seq INTEGER PRIMARY KEY AUTOINCREMENT,"
+                      "op TEXT NOT NULL,"
+                      "month INTEGER NOT NULL,"
+                      "row_id INTEGER NOT NULL,"
+                      "day_month_year TEXT,"
+                      "SpentOn TEXT,"
+                      "Price REAL,"
+                      "CategoryId INTEGER,"
+                      "ModeOfPaymentId INTEGER,"
+                      "changed_at TEXT NOT NULL DEFAULT (datetime('now')));";
     executeSQL(detailedDB, sql);
+    executeSQL(detailedDB, "CREATE INDEX IF NOT EXISTS ChangeLog_row ON ChangeLog (month, row_id, seq);");
+    // Highest seq dropped without a newer entry for the same row; readers
+    // behind it have missed changes and must start over
+    executeSQL(detailedDB, "CREATE TABLE IF NOT EXISTS ChangeLogState (id INTEGER PRIMARY KEY CHECK (id = 1), truncated_through INTEGER NOT NULL);");
+    executeSQL(detailedDB, "INSERT OR IGNORE INTO ChangeLogState (id, truncated_through) VALUES (1, 0);");
 }
 
-double FinanceDB::calculateCurrentSavings(double salary) {
-    std::string sql = "SELECT SUM(Price) FROM " + currentTableName + ";";
+// Priority is derived from the other rows and rewritten on every insert, so
+// updates touching only Priority are not logged
+void FinanceDB::createChangeTriggers(const std::string& tableName) {
+    std::string month = std::to_string(tableMonth(tableName));
+    std::string columns = " (op, month, row_id, day_month_year, SpentOn, Price, CategoryId, ModeOfPaymentId) VALUES ";
+    std::string newRow = ", NEW.rowid, NEW.day_month_year, NEW.SpentOn, NEW.Price, NEW.CategoryId, NEW.ModeOfPaymentId); END;";
+    executeSQL(detailedDB, "CREATE TRIGGER IF NOT EXISTS " + tableName + "_log_insert AFTER INSERT ON " + tableName +
+                           " BEGIN INSERT INTO ChangeLog" + columns + "('insert', " + month + newRow);
+    executeSQL(detailedDB, "CREATE TRIGGER IF NOT EXISTS " + tableName + "_log_update AFTER UPDATE OF "
+                           "day_month_year, SpentOn, Price, CategoryId, ModeOfPaymentId ON " + tableName +
+                           " BEGIN INSERT INTO ChangeLog" + columns + "('update', " + month + newRow);
+    executeSQL(detailedDB, "CREATE TRIGGER IF NOT EXISTS " + tableName + "_log_delete AFTER DELETE ON " + tableName +
+                           " BEGIN INSERT INTO ChangeLog (op, month, row_id) VALUES ('delete', " + month + ", OLD.rowid); END;");
+}
+
+void FinanceDB::createSyncTables() {
+    executeSQL(detailedDB, "CREATE TABLE IF NOT EXISTS FieldClock ("
+                           "month INTEGER NOT NULL,"
+                           "row_id INTEGER NOT NULL,"
+                           "field TEXT NOT NULL,"
+                           "ts INTEGER NOT NULL,"
+                           "client_id TEXT NOT NULL DEFAULT '',"
+                           "PRIMARY KEY (month, row_id, field)) WITHOUT ROWID;");
+    executeSQL(detailedDB, "CREATE TABLE IF NOT EXISTS SyncApplied ("
+                           "client_id TEXT NOT NULL,"
+                           "mutation_id TEXT NOT NULL,"
+                           "status TEXT NOT NULL,"
+                           "row_id INTEGER NOT NULL,"
+                           "applied_at INTEGER NOT NULL,"
+                           "PRIMARY KEY (client_id, mutation_id)) WITHOUT ROWID;");
+}
+
+// Stamps every field an ordinary write changes with the server's clock, so
+// an offline edit made before it loses. Sync writes overwrite the stamp with
+// the client's own right after.
+void FinanceDB::createClockTriggers(const std::string& tableName) {
+    static const struct {
+        const char* column;
+        const char* field;
+    } fields[] = {
+        {"day_month_year", "date"},       {"SpentOn", "spent_on"},
+        {"Price", "price"},               {"CategoryId", "category"},
+        {"ModeOfPaymentId", "mode_of_payment"},
+    };
+    std::string month = std::to_string(tableMonth(tableName));
+    std::string stamps;
+    for (const auto& f : fields) {
+        if (!stamps.empty()) stamps += ", ";
+        stamps += "(" + month + ", NEW.rowid, '" + f.field + "', " + NOW_MS_SQL + ")";
+        executeSQL(detailedDB, "CREATE TRIGGER IF NOT EXISTS " + tableName + "_clock_" + f.field + " AFTER UPDATE OF " + f.column +
+                               " ON " + tableName + " WHEN OLD." + f.column + " IS NOT NEW." + f.column +
+                               " BEGIN INSERT OR REPLACE INTO FieldClock (month, row_id, field, ts) VALUES (" + month +
+                               ", NEW.rowid, '" + f.field + "', " + NOW_MS_SQL + "); END;");
+    }
+    executeSQL(detailedDB, "CREATE TRIGGER IF NOT EXISTS " + tableName + "_clock_insert AFTER INSERT ON " + tableName +
+                           " BEGIN INSERT OR REPLACE INTO FieldClock (month, row_id, field, ts) VALUES " + stamps + "; END;");
+    executeSQL(detailedDB, "CREATE TRIGGER IF NOT EXISTS " + tableName + "_clock_delete AFTER DELETE ON " + tableName +
+                           " BEGIN DELETE FROM FieldClock WHERE month = " + month + " AND row_id = OLD.rowid; END;");
+}
+
+// Converts a month table from the old layout (Category/ModeOfPayment stored as
+// TEXT on every row) to dictionary ids. Tables already converted are left alone.
+// Returns false, with the month's TEXT columns left as they were, if any
+// value can't be given an id or any step fails; the caller then keeps the
+// schema version so the next start tries again.
+bool FinanceDB::migrateDictionaryColumns(const std::string& tableName) {
+    std::vector<std::string> columns;
     sqlite3_stmt* stmt;
-    double totalSpent = 0.0;
-    
-    if (sqlite3_prepare_v2(detailedDB, sql.c_str(), -1, &stmt, 0) == SQLITE_OK) {
-        if (sqlite3_step(stmt) == SQLITE_ROW) {
-            totalSpent = sqlite3_column_double(stmt, 0);
+    std::string sql = "PRAGMA table_info(" + tableName + ");";
+    if (prepare(detailedDB, sql, &stmt) == SQLITE_OK) {
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            columns.push_back(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1)));
+        }
+    }
+    sqlite3_finalize(stmt);
+    auto hasColumn = [&columns](const std::string& name) {
+        return std::find(columns.begin(), columns.end(), name) != columns.end();
+    };
+
+    const struct {
+        const char* textColumn;
+        const char* idColumn;
+        std::function<int(const std::string&)> resolve;
+    } encodings[] = {
+        {"Category", "CategoryId", [this](const std::string& name) { return resolveCategoryId(name); }},
+        {"ModeOfPayment", "ModeOfPaymentId", [this](const std::string& name) { return resolveModeOfPaymentId(name); }},
+    };
+
+    for (const auto& enc : encodings) {
+        if (!hasColumn(enc.idColumn) &&
+            !executeSQL(detailedDB, "ALTER TABLE " + tableName + " ADD COLUMN " + enc.idColumn + " INTEGER;")) {
+            return false;
+        }
+        if (!hasColumn(enc.textColumn)) continue;
+
+        std::vector<std::string> values;
+        sql = std::string("SELECT DISTINCT ") + enc.textColumn + " FROM " + tableName + " WHERE " + enc.textColumn + " IS NOT NULL;";
+        if (prepare(detailedDB, sql, &stmt) != SQLITE_OK) {
+            logError("Migration failed").field("table", tableName).field("error", sqlite3_errmsg(detailedDB));
+            sqlite3_finalize(stmt);
+            return false;
+        }
+        int rc;
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            values.push_back(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)));
+        }
+        sqlite3_finalize(stmt);
+        if (rc != SQLITE_DONE) {
+            logError("Migration failed").field("table", tableName).field("error", sqlite3_errstr(rc));
+            return false;
+        }
+
+        // Every id is resolved, adding names to Main.db as needed, before
+        // Detailed.db is touched. An empty name is stored as no id.
+        std::vector<std::pair<std::string, int>> ids;
+        for (const auto& value : values) {
+            int id = value.empty() ? 0 : enc.resolve(value);
+            if (!value.empty() && id <= 0) {
+                logError("Migration failed, no id for name").field("table", tableName).field("column", enc.textColumn).field("name", value);
+                return false;
+            }
+            ids.push_back({value, id});
+        }
+
+        if (!executeSQL(detailedDB, "BEGIN;")) return false;
+        bool ok = true;
+        sql = std::string("UPDATE ") + tableName + " SET " + enc.idColumn + " = ?, " + enc.textColumn + " = NULL WHERE " + enc.textColumn + " = ?;";
+        if (prepare(detailedDB, sql, &stmt) == SQLITE_OK) {
+            for (const auto& entry : ids) {
+                if (entry.second > 0) {
+                    sqlite3_bind_int(stmt, 1, entry.second);
+                } else {
+                    sqlite3_bind_null(stmt, 1);
+                }
+                sqlite3_bind_text(stmt, 2, entry.first.c_str(), -1, SQLITE_STATIC);
+                if (sqlite3_step(stmt) != SQLITE_DONE) {
+                    logError("Migration failed").field("table", tableName).field("error", sqlite3_errmsg(detailedDB));
+                    ok = false;
+                    break;
+                }
+                sqlite3_reset(stmt);
+            }
+        } else {
+            logError("Migration failed").field("table", tableName).field("error", sqlite3_errmsg(detailedDB));
+            ok = false;
+        }
+        sqlite3_finalize(stmt);
+
+        // Nothing may be left in the TEXT column, e.g. a value written meanwhile
+        if (ok) {
+            sql = std::string("SELECT COUNT(*) FROM ") + tableName + " WHERE " + enc.textColumn + " IS NOT NULL;";
+            ok = prepare(detailedDB, sql, &stmt) == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int64(stmt, 0) == 0;
+            sqlite3_finalize(stmt);
+            if (!ok) logError("Migration failed, names left unencoded").field("table", tableName).field("column", enc.textColumn);
+        }
+        if (!ok || !executeSQL(detailedDB, "COMMIT;")) {
+            executeSQL(detailedDB, "ROLLBACK;");
+            return false;
+        }
+
+        // DROP COLUMN needs SQLite 3.35; on older versions the emptied column just stays behind
+        if (sqlite3_libversion_number() >= 3035000) {
+            executeSQL(detailedDB, "ALTER TABLE " + tableName + " DROP COLUMN " + enc.textColumn + ";");
+        }
+    }
+    return true;
+}
+
+std::vector<std::string> FinanceDB::listExpenseTables(bool withArchive) {
+    std::vector<std::string> tables;
+    if (!detailedDB) return tables;
+
+    // A month cut short while being archived is in both; UNION lists it once
+    std::string sql = "SELECT name FROM main.sqlite_master WHERE type = 'table' AND name LIKE 'expenses\\_%' ESCAPE '\\'";
+    if (withArchive && archiveAttached) {
+        sql += " UNION SELECT name FROM archive.sqlite_master WHERE type = 'table' AND name LIKE 'expenses\\_%' ESCAPE '\\'";
+    }
+    sql += ";";
+    sqlite3_stmt* stmt;
+    if (prepare(detailedDB, sql, &stmt) == SQLITE_OK) {
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            tables.push_back(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)));
         }
     }
     sqlite3_finalize(stmt);
+    return tables;
+}
+
+// YYYYMM for an expenses_MM_YYYY table name, 0 if the name doesn't match
+int FinanceDB::tableMonth(const std::string& tableName) {
+    int month = 0, year = 0;
+    if (std::sscanf(tableName.c_str(), "expenses_%d_%d", &month, &year) != 2) return 0;
+    return year * 100 + month;
+}
+
+void FinanceDB::enableAnalyticsSnapshot() {
+    if (!detailedDB || analyticsEnabled.exchange(true)) return;
+
+    // Writes made while the load runs are mirrored too; upsert keeps them
+    // from being counted twice. Each month is read and loaded under
+    // writeMutex: a delete or edit landing between reading a row and
+    // upserting it would find nothing to change in the snapshot, and the
+    // upsert would then bring back the old row. Writers wait one month's
+    // scan at most.
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& table : listExpenseTables()) {
+        std::lock_guard<std::recursive_mutex> lock(writeMutex);
+        int month = tableMonth(table);
+        std::string sql = "SELECT rowid, day_month_year, SpentOn, Price, CategoryId, ModeOfPaymentId FROM " + table + ";";
+        sqlite3_stmt* stmt;
+        if (prepare(detailedDB, sql, &stmt) == SQLITE_OK) {
+            while (sqlite3_step(stmt) == SQLITE_ROW) {
+                analytics.upsert(month, sqlite3_column_int(stmt, 0),
+                                 reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1)),
+                                 reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2)),
+                                 sqlite3_column_double(stmt, 3), sqlite3_column_int(stmt, 4), sqlite3_column_int(stmt, 5));
+            }
+        } else {
+            logError("Failed to load table into analytics snapshot").field("table", table).field("error", sqlite3_errmsg(detailedDB));
+        }
+        sqlite3_finalize(stmt);
+    }
+    analyticsReady = true;
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    logInfo("Analytics snapshot loaded.")
+        .field("rows", analytics.size())
+        .field("kib", analytics.memoryBytes() / 1024)
+        .field("ms", static_cast<long long>(elapsed.count()));
+}
+
+// Seeds the typeahead index with every known name, weighted by how often it
+// was used across all months. Safe to run while requests are served; the scan
+// reads one snapshot, and an expense added during it may be counted twice.
+void FinanceDB::loadSuggestIndex() {
+    for (const auto& category : getAllCategories()) {
+        suggestIndex.recordUse(SuggestKind::Category, category, 0);
+    }
+    for (const auto& mode : getAllModeOfPayment()) {
+        suggestIndex.recordUse(SuggestKind::ModeOfPayment, mode, 0);
+    }
+
+    auto categories = categoriesCache.get();
+    auto modes = modesCache.get();
+    const struct {
+        const char* column;
+        SuggestKind kind;
+        const RefDataSnapshot* dictionary; // null for plain text columns
+    } columns[] = {
+        {"SpentOn", SuggestKind::Item, nullptr},
+        {"CategoryId", SuggestKind::Category, categories.get()},
+        {"ModeOfPaymentId", SuggestKind::ModeOfPayment, modes.get()},
+    };
+    ReadPool::Lease reader = readers.lease(detailedDB);
+    for (const auto& table : listExpenseTables()) {
+        for (const auto& column : columns) {
+            std::string sql = std::string("SELECT ") + column.column + ", COUNT(*) FROM " + table +
+                              " WHERE " + column.column + " IS NOT NULL GROUP BY " + column.column + ";";
+            sqlite3_stmt* stmt;
+            if (prepare(reader.db(), sql, &stmt) == SQLITE_OK) {
+                while (sqlite3_step(stmt) == SQLITE_ROW) {
+                    int uses = sqlite3_column_int(stmt, 1);
+                    if (column.dictionary) {
+                        suggestIndex.recordUse(column.kind, column.dictionary->name(sqlite3_column_int(stmt, 0)), uses);
+                    } else {
+                        suggestIndex.recordUse(column.kind, reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)), uses);
+                    }
+                }
+            }
+            sqlite3_finalize(stmt);
+        }
+    }
+}
+
+std::vector<Suggestion> FinanceDB::suggest(SuggestKind kind, const std::string& prefix, size_t limit) const {
+    return suggestIndex.suggest(kind, prefix, limit);
+}
+
+double FinanceDB::calculateCurrentSavings(double salary) {
+    double totalSpent = calcTotalSpent();
 
     if (salary > 0) {
         double saved = salary - totalSpent;
@@ -142,8 +668,8 @@ bool FinanceDB::addOrUpdateMonthlySummary(double salary, double limit) {
                       "Salary=excluded.Salary, LimitAmount=excluded.LimitAmount, SavingPercentage=excluded.SavingPercentage, Condition=excluded.Condition;";
                        // This updates the existing row instead of inserting a new one. It uses the excluded keyword, which refers to the values that were attempted to be inserted.
     sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(mainDB, sql.c_str(), -1, &stmt, 0) != SQLITE_OK) {
-        std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(mainDB) << std::endl;
+    if (prepare(mainDB, sql, &stmt) != SQLITE_OK) {
+        logError("Failed to prepare statement").field("error", sqlite3_errmsg(mainDB));
         return false;
     }
     // The 1 is the parameter index, -1 indicates a null-terminated string, and SQLITE_STATIC tells SQLite the string won't change or be freed during execution.
@@ -155,16 +681,18 @@ bool FinanceDB::addOrUpdateMonthlySummary(double salary, double limit) {
     sqlite3_bind_text(stmt, 5, condition.c_str(), -1, SQLITE_STATIC);
 
     if (sqlite3_step(stmt) != SQLITE_DONE) {
-        std::cerr << "Execution failed: " << sqlite3_errmsg(mainDB) << std::endl;
+        logError("Execution failed").field("error", sqlite3_errmsg(mainDB));
         sqlite3_finalize(stmt);
         return false;
     }
     sqlite3_finalize(stmt);
+    budget.setMonthLimit(limit);
     return true;
 }
 
-bool FinanceDB::addExpense(const std::string& spentOn, double price, const std::optional<std::string>& category, const std::optional<std::string>& date, const std::optional<std::string>& modeOfPayment) {
+bool FinanceDB::addExpense(const std::string& spentOn, double price, const std::optional<std::string>& category, const std::optional<std::string>& date, const std::optional<std::string>& modeOfPayment, int* newId) {
     if (!detailedDB) return false;
+    std::lock_guard<std::recursive_mutex> lock(writeMutex);
 
     std::string dayMonthYear;
     if (date && !date->empty()) {
@@ -173,11 +701,11 @@ bool FinanceDB::addExpense(const std::string& spentOn, double price, const std::
         dayMonthYear = getCurrentDayMonthYear();
     }
     
-    std::string sql = "INSERT INTO " + currentTableName + " (day_month_year, SpentOn, Price, Category, ModeOfPayment, Priority) VALUES (?, ?, ?, ?, ?, 0);";
+    std::string sql = "INSERT INTO " + currentTableName + " (day_month_year, SpentOn, Price, CategoryId, ModeOfPaymentId, Priority) VALUES (?, ?, ?, ?, ?, 0);";
     
     sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(detailedDB, sql.c_str(), -1, &stmt, 0) != SQLITE_OK) {
-        std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(detailedDB) << std::endl;
+    if (prepare(detailedDB, sql, &stmt) != SQLITE_OK) {
+        logError("Failed to prepare statement").field("error", sqlite3_errmsg(detailedDB));
         return false;
     }
 
@@ -188,36 +716,49 @@ bool FinanceDB::addExpense(const std::string& spentOn, double price, const std::
     sqlite3_bind_text(stmt, 2, spentOn.c_str(), -1, SQLITE_STATIC);
     sqlite3_bind_double(stmt, 3, price);
     
-    if (category && !category->empty()) {
-        sqlite3_bind_text(stmt, 4, category->c_str(), -1, SQLITE_STATIC);
+    int categoryId = (category && !category->empty()) ? resolveCategoryId(*category) : 0;
+    if (categoryId > 0) {
+        sqlite3_bind_int(stmt, 4, categoryId);
     } else {
         sqlite3_bind_null(stmt, 4);
     }
 
-    if (modeOfPayment && !modeOfPayment->empty()) {
-        sqlite3_bind_text(stmt, 5, modeOfPayment->c_str(), -1, SQLITE_STATIC);
+    int modeOfPaymentId = (modeOfPayment && !modeOfPayment->empty()) ? resolveModeOfPaymentId(*modeOfPayment) : 0;
+    if (modeOfPaymentId > 0) {
+        sqlite3_bind_int(stmt, 5, modeOfPaymentId);
     } else {
         sqlite3_bind_null(stmt, 5);
     }
 
     if (sqlite3_step(stmt) != SQLITE_DONE) {
-        std::cerr << "Execution failed: " << sqlite3_errmsg(detailedDB) << std::endl;
+        logError("Execution failed").field("error", sqlite3_errmsg(detailedDB));
         sqlite3_finalize(stmt);
         return false;
     }
     sqlite3_finalize(stmt);
+    int id = static_cast<int>(sqlite3_last_insert_rowid(detailedDB));
+
+    if (analyticsEnabled) {
+        analytics.upsert(currentMonth, id, uniqueDayKey, spentOn, price, categoryId, modeOfPaymentId);
+    }
+    budget.record(categoryId, price);
     
     updatePriority(spentOn);
+    if (category && !category->empty()) suggestIndex.recordUse(SuggestKind::Category, *category);
+    if (modeOfPayment && !modeOfPayment->empty()) suggestIndex.recordUse(SuggestKind::ModeOfPayment, *modeOfPayment);
 
+    notifyChange(ChangeKind::Insert, id);
+    if (newId) *newId = id;
     return true;
 }
 
 void FinanceDB::updatePriority(const std::string& spentOn) {
+    std::lock_guard<std::recursive_mutex> lock(writeMutex);
     // Step 1: Get the count of the item
     std::string count_sql = "SELECT COUNT(*) FROM " + currentTableName + " WHERE SpentOn = ?;";
     sqlite3_stmt* count_stmt;
     int count = 0;
-    if (sqlite3_prepare_v2(detailedDB, count_sql.c_str(), -1, &count_stmt, 0) == SQLITE_OK) {
+    if (prepare(detailedDB, count_sql, &count_stmt) == SQLITE_OK) {
         sqlite3_bind_text(count_stmt, 1, spentOn.c_str(), -1, SQLITE_STATIC);
         if (sqlite3_step(count_stmt) == SQLITE_ROW) {
             count = sqlite3_column_int(count_stmt, 0);
@@ -228,14 +769,17 @@ void FinanceDB::updatePriority(const std::string& spentOn) {
     // Step 2: Update the priority for all items with this name
     std::string update_sql = "UPDATE " + currentTableName + " SET Priority = ? WHERE SpentOn = ?;";
     sqlite3_stmt* update_stmt;
-    if (sqlite3_prepare_v2(detailedDB, update_sql.c_str(), -1, &update_stmt, 0) == SQLITE_OK) {
+    if (prepare(detailedDB, update_sql, &update_stmt) == SQLITE_OK) {
         sqlite3_bind_int(update_stmt, 1, count);
         sqlite3_bind_text(update_stmt, 2, spentOn.c_str(), -1, SQLITE_STATIC);
         if (sqlite3_step(update_stmt) != SQLITE_DONE) {
-            std::cerr << "Execution failed: " << sqlite3_errmsg(detailedDB) << std::endl;
+            logError("Execution failed").field("error", sqlite3_errmsg(detailedDB));
         }
     }
     sqlite3_finalize(update_stmt);
+
+    // Step 3: Every priority bump is one more use of the name for typeahead
+    suggestIndex.recordUse(SuggestKind::Item, spentOn);
 }
 
 
@@ -243,32 +787,41 @@ void FinanceDB::updatePriority(const std::string& spentOn) {
 /********** NEW FUNCTIONS FOR VIEWING DATA *********/
 /***************************************************/
 
+// Column list shared by every query that reads whole expense rows
+static const std::string EXPENSE_COLUMNS = "rowid, day_month_year, SpentOn, Price, CategoryId, ModeOfPaymentId, Priority";
+
+// Reads a row selected with EXPENSE_COLUMNS. NULL ids come back as 0.
+static ExpenseRecord readExpenseRecord(sqlite3_stmt* stmt) {
+    ExpenseRecord e;
+    e.id = sqlite3_column_int(stmt, 0);
+    e.day_month_year = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+    e.spent_on = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
+    e.price = sqlite3_column_double(stmt, 3);
+    e.category_id = sqlite3_column_int(stmt, 4);
+    e.mode_of_payment_id = sqlite3_column_int(stmt, 5);
+    e.priority = sqlite3_column_int(stmt, 6);
+    return e;
+}
+
 std::vector<ExpenseRecord> FinanceDB::getRangeOfDate(std::string start_date,std::string end_date){
     std::vector<ExpenseRecord>summaries; 
     // The reinterpret_cast<const char*> is used because sqlite3_column_text returns a const unsigned char* (for UTF-8 bytes), but std::string constructors expect const char*. This cast safely converts the pointer type for string assignment, as UTF-8 bytes are compatible. It's necessary to assign the column text to e.day_month_year and e.spent_on. The cast doesn't change data, just the pointer type. Avoid modifying the returned string, as SQLite manages its lifetime.
 
     //     reinterpret_cast<const char*> is used because unsigned char* and char* are unrelated pointer types, requiring a low-level reinterpretation of the pointer bits. static_cast doesn't work for unrelated pointers. dynamic_cast is for polymorphic classes, not applicable here. const_cast removes const, but doesn't change types. A C-style cast (const char*) would work but is less safe and explicit. reinterpret_cast is the correct, standard choice for this conversion.
 
-    std::string sql="SELECT rowid, day_month_year, SpentOn, Price, Category, ModeOfPayment, Priority FROM "+currentTableName+" WHERE day_month_year BETWEEN ? AND ?";
+    std::string sql="SELECT " + EXPENSE_COLUMNS + " FROM "+currentTableName+" WHERE day_month_year BETWEEN ? AND ?";
 
+    ReadPool::Lease reader = readers.lease(detailedDB);
     sqlite3_stmt* stmt;
 
-    if (sqlite3_prepare_v2(detailedDB, sql.c_str(), -1, &stmt, 0) == SQLITE_OK) {
+    if (prepare(reader.db(), sql, &stmt) == SQLITE_OK) {
         sqlite3_bind_text(stmt, 1, start_date.c_str(), -1, SQLITE_STATIC);
         sqlite3_bind_text(stmt, 2, end_date.c_str(), -1, SQLITE_STATIC);
         while (sqlite3_step(stmt) == SQLITE_ROW) {
-            ExpenseRecord e;
-            e.id = sqlite3_column_int(stmt, 0);
-            e.day_month_year = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-            e.spent_on = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-            e.price = sqlite3_column_double(stmt, 3);
-            e.category = sqlite3_column_type(stmt, 4) == SQLITE_NULL ? "" : reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4));
-            e.mode_of_payment = sqlite3_column_type(stmt, 5) == SQLITE_NULL ? "" : reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
-            e.priority = sqlite3_column_int(stmt, 6);
-            summaries.push_back(e);
+            summaries.push_back(readExpenseRecord(stmt));
         }
     } else {
-        std::cerr << "Failed to prepare statement for getRangeOfDate: " << sqlite3_errmsg(detailedDB) << std::endl;
+        logError("Failed to prepare statement for getRangeOfDate").field("error", sqlite3_errmsg(reader.db()));
     }
     sqlite3_finalize(stmt);
     return summaries;
@@ -276,27 +829,20 @@ std::vector<ExpenseRecord> FinanceDB::getRangeOfDate(std::string start_date,std:
 
 std::vector<ExpenseRecord> FinanceDB::getItemByDateRange(std::string item, std::string start_date, std::string end_date){
     std::vector<ExpenseRecord>summaries;
-    std::string sql="SELECT rowid, day_month_year, SpentOn, Price, Category, ModeOfPayment, Priority FROM "+currentTableName+" WHERE SpentOn LIKE ? AND day_month_year BETWEEN ? AND ?";
+    std::string sql="SELECT " + EXPENSE_COLUMNS + " FROM "+currentTableName+" WHERE SpentOn LIKE ? AND day_month_year BETWEEN ? AND ?";
+    ReadPool::Lease reader = readers.lease(detailedDB);
     sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(detailedDB, sql.c_str(), -1, &stmt, 0) == SQLITE_OK) {
+    if (prepare(reader.db(), sql, &stmt) == SQLITE_OK) {
         std::string itemPattern = "%" + item + "%";
         sqlite3_bind_text(stmt, 1, itemPattern.c_str(), -1, SQLITE_STATIC);
         sqlite3_bind_text(stmt, 2, start_date.c_str(), -1, SQLITE_STATIC);
         sqlite3_bind_text(stmt, 3, end_date.c_str(), -1, SQLITE_STATIC);
         // ouput formatting
         while (sqlite3_step(stmt) == SQLITE_ROW) {
-            ExpenseRecord e;
-            e.id = sqlite3_column_int(stmt, 0);
-            e.day_month_year = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-            e.spent_on = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-            e.price = sqlite3_column_double(stmt, 3);
-            e.category = sqlite3_column_type(stmt, 4) == SQLITE_NULL ? "" : reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4));
-            e.mode_of_payment = sqlite3_column_type(stmt, 5) == SQLITE_NULL ? "" : reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
-            e.priority = sqlite3_column_int(stmt, 6);
-            summaries.push_back(e);
+            summaries.push_back(readExpenseRecord(stmt));
         }
     } else {
-        std::cerr << "Failed to prepare statement for getItemByDateRange: " << sqlite3_errmsg(detailedDB) << std::endl;
+        logError("Failed to prepare statement for getItemByDateRange").field("error", sqlite3_errmsg(reader.db()));
     }
     sqlite3_finalize(stmt);
     return summaries;
@@ -307,12 +853,31 @@ std::map<std::string, double> FinanceDB::getMonthlyTotalsForYear(int year){
     std::vector<std::string> months = {"01", "02", "03", "04", "05", "06", "07", "08", "09", "10", "11", "12"};
     std::vector<std::string> monthNames = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
 
+    if (useAnalytics()) {
+        auto totals = analytics.monthlyTotals(year);
+        for (size_t i = 0; i < monthNames.size(); ++i) {
+            monthlyTotals[monthNames[i]] = totals[i] > 0 ? totals[i] : 0.0;
+        }
+        return monthlyTotals;
+    }
+
+    // Archived months come from their rollup instead of a scan
+    std::map<int, double> archived;
+    for (const auto& month : getArchivedMonths()) {
+        if (month.month / 100 == year) archived[month.month % 100] = month.total;
+    }
+    ReadPool::Lease reader = readers.lease(detailedDB);
     for (size_t i = 0; i < months.size(); ++i) {
+        auto rollup = archived.find(static_cast<int>(i) + 1);
+        if (rollup != archived.end()) {
+            monthlyTotals[monthNames[i]] = rollup->second;
+            continue;
+        }
         std::string tableName = "expenses_" + months[i] + "_" + std::to_string(year);
         std::string sql = "SELECT SUM(Price) FROM " + tableName;
         sqlite3_stmt* stmt;
 
-        if (sqlite3_prepare_v2(detailedDB, sql.c_str(), -1, &stmt, 0) == SQLITE_OK) {
+        if (prepare(reader.db(), sql, &stmt) == SQLITE_OK) {
             if (sqlite3_step(stmt) == SQLITE_ROW) {
                 double total = sqlite3_column_double(stmt, 0);
                 monthlyTotals[monthNames[i]] = total > 0 ? total : 0.0;
@@ -328,32 +893,80 @@ std::map<std::string, double> FinanceDB::getMonthlyTotalsForYear(int year){
 std::vector<ExpenseRecord> FinanceDB::calcSortByPrice(bool order){
     std::vector<ExpenseRecord>summaries; 
     std::string ordering=(order)?"ASC":"DESC";
-    std::string sql="SELECT rowid, day_month_year, SpentOn, Price, Category, ModeOfPayment, Priority FROM "+currentTableName+" ORDER BY Price "+ordering;
+    std::string sql="SELECT " + EXPENSE_COLUMNS + " FROM "+currentTableName+" ORDER BY Price "+ordering;
+    ReadPool::Lease reader = readers.lease(detailedDB);
     sqlite3_stmt* stmt;
 
-    if (sqlite3_prepare_v2(detailedDB, sql.c_str(), -1, &stmt, 0) == SQLITE_OK) {
+    if (prepare(reader.db(), sql, &stmt) == SQLITE_OK) {
         while (sqlite3_step(stmt) == SQLITE_ROW) {
-            ExpenseRecord e;
-            e.id = sqlite3_column_int(stmt, 0);
-            e.day_month_year = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-            e.spent_on = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-            e.price = sqlite3_column_double(stmt, 3);
-            e.category = sqlite3_column_type(stmt, 4) == SQLITE_NULL ? "" : reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4));
-            e.mode_of_payment = sqlite3_column_type(stmt, 5) == SQLITE_NULL ? "" : reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
-            e.priority = sqlite3_column_int(stmt, 6);
-            summaries.push_back(e);
+            summaries.push_back(readExpenseRecord(stmt));
         }
     }
     sqlite3_finalize(stmt);
     return summaries;
 }
 
+std::vector<ExpenseRecord> FinanceDB::topByPrice(size_t k, bool descending) {
+    std::vector<ExpenseRecord> top;
+    if (!detailedDB) return top;
+    std::string sql = "SELECT " + EXPENSE_COLUMNS + " FROM " + currentTableName + " ORDER BY Price " +
+                      (descending ? "DESC" : "ASC") + " LIMIT ?;";
+    ReadPool::Lease reader = readers.lease(detailedDB);
+    sqlite3_stmt* stmt;
+    if (prepare(reader.db(), sql, &stmt) == SQLITE_OK) {
+        sqlite3_bind_int64(stmt, 1, static_cast<sqlite3_int64>(k));
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            top.push_back(readExpenseRecord(stmt));
+        }
+    }
+    sqlite3_finalize(stmt);
+    return top;
+}
+
+PriceDistribution FinanceDB::priceQuantiles(const std::vector<double>& quantiles) {
+    if (useAnalytics()) return analytics.priceQuantiles(currentMonth, quantiles);
+
+    // Without the snapshot the ranks are read in one walk of the Price index.
+    // SQLite keeps no subtree counts, so this path stays linear in the month;
+    // an OFFSET per quantile would walk it once per quantile instead.
+    PriceDistribution result;
+    if (!detailedDB) return result;
+    ReadPool::Lease reader = readers.lease(detailedDB);
+    sqlite3_stmt* stmt;
+    if (prepare(reader.db(), "SELECT COUNT(*) FROM " + currentTableName + ";", &stmt) == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW) {
+        result.count = static_cast<size_t>(sqlite3_column_int64(stmt, 0));
+    }
+    sqlite3_finalize(stmt);
+    if (result.count == 0) return result;
+
+    std::vector<std::pair<size_t, size_t>> ranks; // (rank, quantile index), walked in rank order
+    for (size_t i = 0; i < quantiles.size(); ++i) {
+        size_t rank = static_cast<size_t>(std::ceil(quantiles[i] * result.count));
+        ranks.push_back({std::min(std::max<size_t>(rank, 1), result.count), i});
+    }
+    std::sort(ranks.begin(), ranks.end());
+    result.prices.assign(quantiles.size(), 0.0);
+    stmt = nullptr;
+    if (!ranks.empty() &&
+        prepare(reader.db(), "SELECT Price FROM " + currentTableName + " ORDER BY Price LIMIT ?;", &stmt) == SQLITE_OK) {
+        sqlite3_bind_int64(stmt, 1, static_cast<sqlite3_int64>(ranks.back().first));
+        size_t seen = 0, next = 0;
+        while (next < ranks.size() && sqlite3_step(stmt) == SQLITE_ROW) {
+            ++seen;
+            double price = sqlite3_column_double(stmt, 0);
+            while (next < ranks.size() && ranks[next].first == seen) result.prices[ranks[next++].second] = price;
+        }
+    }
+    sqlite3_finalize(stmt);
+    return result;
+}
+
 std::vector<MonthlySummary> FinanceDB::getAllSummaries() {
     std::vector<MonthlySummary> summaries;
     std::string sql = "SELECT * FROM Overall;";
     sqlite3_stmt* stmt;
 
-    if (sqlite3_prepare_v2(mainDB, sql.c_str(), -1, &stmt, 0) == SQLITE_OK) {
+    if (prepare(mainDB, sql, &stmt) == SQLITE_OK) {
         while (sqlite3_step(stmt) == SQLITE_ROW) {
             MonthlySummary s;
             s.month_year = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
@@ -370,20 +983,13 @@ std::vector<MonthlySummary> FinanceDB::getAllSummaries() {
 
 std::vector<ExpenseRecord> FinanceDB::getSortedByVal() {
     std::vector<ExpenseRecord> summaries;
-    std::string sql = "SELECT rowid, day_month_year, SpentOn, Price, Category, ModeOfPayment, Priority FROM " + currentTableName + " ORDER BY Price DESC;";
+    std::string sql = "SELECT " + EXPENSE_COLUMNS + " FROM " + currentTableName + " ORDER BY Price DESC;";
+    ReadPool::Lease reader = readers.lease(detailedDB);
     sqlite3_stmt* stmt;
 
-    if (sqlite3_prepare_v2(detailedDB, sql.c_str(), -1, &stmt, 0) == SQLITE_OK) {
+    if (prepare(reader.db(), sql, &stmt) == SQLITE_OK) {
         while (sqlite3_step(stmt) == SQLITE_ROW) {
-            ExpenseRecord e;
-            e.id = sqlite3_column_int(stmt, 0);
-            e.day_month_year = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-            e.spent_on = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-            e.price = sqlite3_column_double(stmt, 3);
-            e.category = sqlite3_column_type(stmt, 4) == SQLITE_NULL ? "" : reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4));
-            e.mode_of_payment = sqlite3_column_type(stmt, 5) == SQLITE_NULL ? "" : reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
-            e.priority = sqlite3_column_int(stmt, 6);
-            summaries.push_back(e);
+            summaries.push_back(readExpenseRecord(stmt));
         }
     }
     sqlite3_finalize(stmt);
@@ -391,13 +997,26 @@ std::vector<ExpenseRecord> FinanceDB::getSortedByVal() {
 }
 
 std::vector<ExpenseRecord> FinanceDB::calcPriority() {
+    if (useAnalytics()) {
+        std::vector<ExpenseRecord> ordered;
+        for (const auto& item : analytics.itemAggregates(currentMonth)) {
+            ExpenseRecord e{};
+            e.spent_on = item.spent_on;
+            e.price = item.total / item.count;
+            e.priority = item.count;
+            ordered.push_back(e);
+        }
+        return ordered;
+    }
+
     // SQL to get SpentOn, average price, and count of occurrences (priority)
     // Ordered by count (priority) in descending order
+    ReadPool::Lease reader = readers.lease(detailedDB);
     std::string sql = "SELECT SpentOn, AVG(Price), COUNT(*) AS num_occurrences FROM " + currentTableName + " GROUP BY SpentOn ORDER BY num_occurrences DESC;";
     sqlite3_stmt* stmt;
     std::vector<ExpenseRecord> ordered; // This will hold the aggregated and sorted data
 
-    if (sqlite3_prepare_v2(detailedDB, sql.c_str(), -1, &stmt, 0) == SQLITE_OK) {
+    if (prepare(reader.db(), sql, &stmt) == SQLITE_OK) {
         while (sqlite3_step(stmt) == SQLITE_ROW) {
             ExpenseRecord e;
             e.day_month_year = ""; // Not applicable for grouped data
@@ -407,33 +1026,60 @@ std::vector<ExpenseRecord> FinanceDB::calcPriority() {
             ordered.push_back(e);
         }
     } else {
-        std::cerr << "Failed to prepare statement for calcPriority: " << sqlite3_errmsg(detailedDB) << std::endl;
+        logError("Failed to prepare statement for calcPriority").field("error", sqlite3_errmsg(reader.db()));
     }
     sqlite3_finalize(stmt);
     return ordered;
 }
 
+ItemStats FinanceDB::getItemStats(const std::string& spentOn, const std::string& fromMonthYear, const std::string& toMonthYear) {
+    int fromMonth = fromMonthYear.empty() ? 0 : tableMonth("expenses_" + fromMonthYear);
+    int toMonth = toMonthYear.empty() ? 999912 : tableMonth("expenses_" + toMonthYear);
+    if (useAnalytics()) return analytics.itemStats(spentOn, fromMonth, toMonth);
+
+    // Until the snapshot is loaded: collect the item's prices month by month
+    ItemStats stats;
+    stats.spent_on = spentOn;
+    std::vector<double> prices;
+    ReadPool::Lease reader = readers.lease(detailedDB);
+    for (const auto& table : listExpenseTables()) {
+        int month = tableMonth(table);
+        if (month < fromMonth || month > toMonth) continue;
+        sqlite3_stmt* stmt;
+        if (prepare(reader.db(), "SELECT Price FROM " + table + " WHERE SpentOn = ?;", &stmt) == SQLITE_OK) {
+            sqlite3_bind_text(stmt, 1, spentOn.c_str(), -1, SQLITE_STATIC);
+            while (sqlite3_step(stmt) == SQLITE_ROW) {
+                prices.push_back(sqlite3_column_double(stmt, 0));
+            }
+        }
+        sqlite3_finalize(stmt);
+    }
+    if (prices.empty()) return stats;
+    std::sort(prices.begin(), prices.end());
+    stats.count = static_cast<int>(prices.size());
+    stats.total = std::accumulate(prices.begin(), prices.end(), 0.0);
+    stats.min = prices.front();
+    stats.max = prices.back();
+    auto rank = [&prices](double q) { return prices[std::min(prices.size() - 1, static_cast<size_t>(std::ceil(q * prices.size())) - 1)]; };
+    stats.p50 = rank(0.5);
+    stats.p90 = rank(0.9);
+    return stats;
+}
+
 std::vector<ExpenseRecord> FinanceDB::getExpensesForMonth(const std::string& monthYear) {
     std::vector<ExpenseRecord> expenses;
     std::string tableName = "expenses_" + monthYear;
-    std::string sql = "SELECT rowid, day_month_year, SpentOn, Price, Category, ModeOfPayment, Priority FROM " + tableName + ";";
+    std::string sql = "SELECT " + EXPENSE_COLUMNS + " FROM " + tableName + ";";
+    ReadPool::Lease reader = readers.lease(detailedDB);
     sqlite3_stmt* stmt;
 
     // Check if the table exists by preparing the statement. If it fails, return empty.
-    if (sqlite3_prepare_v2(detailedDB, sql.c_str(), -1, &stmt, 0) == SQLITE_OK) {
+    if (prepare(reader.db(), sql, &stmt) == SQLITE_OK) {
         while (sqlite3_step(stmt) == SQLITE_ROW) {
-            ExpenseRecord e;
-            e.id = sqlite3_column_int(stmt, 0);
-            e.day_month_year = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-            e.spent_on = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-            e.price = sqlite3_column_double(stmt, 3);
-            e.category = sqlite3_column_type(stmt, 4) == SQLITE_NULL ? "" : reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4));
-            e.mode_of_payment = sqlite3_column_type(stmt, 5) == SQLITE_NULL ? "" : reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
-            e.priority = sqlite3_column_int(stmt, 6);
-            expenses.push_back(e);
+            expenses.push_back(readExpenseRecord(stmt));
         }
     } else {
-        std::cerr << "Could not query table " << tableName << ". It might not exist yet." << std::endl;
+        logWarn("Could not query table. It might not exist yet.").field("table", tableName);
     }
     sqlite3_finalize(stmt);
     return expenses;
@@ -444,7 +1090,7 @@ MonthlySummary FinanceDB::getCurrentMonthSummary() {
     std::string sql = "SELECT Salary, LimitAmount FROM Overall WHERE month_year = ?;";
     sqlite3_stmt* stmt;
 
-    if (sqlite3_prepare_v2(mainDB, sql.c_str(), -1, &stmt, 0) == SQLITE_OK) {
+    if (prepare(mainDB, sql, &stmt) == SQLITE_OK) {
         sqlite3_bind_text(stmt, 1, currentYearMonth.c_str(), -1, SQLITE_STATIC);
         if (sqlite3_step(stmt) == SQLITE_ROW) {
             summary.salary = sqlite3_column_double(stmt, 0);
@@ -455,17 +1101,620 @@ MonthlySummary FinanceDB::getCurrentMonthSummary() {
     return summary;
 }
 
+SpendOverview FinanceDB::getSpendOverview() {
+    SpendOverview overview{};
+    if (useAnalytics()) {
+        overview.last7Days = analytics.spendInLastDays(7);
+        overview.last30Days = analytics.spendInLastDays(30);
+        overview.last90Days = analytics.spendInLastDays(90);
+    } else {
+        // Until the snapshot is loaded: fill a throwaway ring from the month
+        // tables that can hold the last 90 days
+        SpendWindows windows;
+        int oldest = SpendWindows::currentDay() - SpendWindows::MAX_DAYS;
+        ReadPool::Lease reader = readers.lease(detailedDB);
+        for (const auto& table : listExpenseTables()) {
+            int month = tableMonth(table);
+            if (SpendWindows::dayNumber(month * 100 + 31) < oldest) continue;
+            sqlite3_stmt* stmt;
+            if (prepare(reader.db(), "SELECT day_month_year, Price FROM " + table + ";", &stmt) == SQLITE_OK) {
+                while (sqlite3_step(stmt) == SQLITE_ROW) {
+                    windows.add(parseExpenseDate(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0))), sqlite3_column_double(stmt, 1));
+                }
+            }
+            sqlite3_finalize(stmt);
+        }
+        overview.last7Days = windows.total(7);
+        overview.last30Days = windows.total(30);
+        overview.last90Days = windows.total(90);
+    }
+    overview.monthToDate = calcTotalSpent();
+    overview.limit = getCurrentMonthSummary().limit;
+
+    std::time_t now = std::time(nullptr);
+    std::tm tm_local;
+    localtime_r(&now, &tm_local);
+    overview.dayOfMonth = tm_local.tm_mday;
+    static const int DAYS_IN_MONTH[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    int year = tm_local.tm_year + 1900;
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    overview.daysInMonth = DAYS_IN_MONTH[tm_local.tm_mon] + (tm_local.tm_mon == 1 && leap ? 1 : 0);
+    return overview;
+}
+
+// One scan of the current month at startup; from then on every write adjusts
+// the running totals itself
+void FinanceDB::loadBudget() {
+    if (!mainDB || !detailedDB) return;
+
+    double spent = 0.0;
+    std::unordered_map<int, double> spentByCategory;
+    sqlite3_stmt* stmt;
+    std::string sql = "SELECT IFNULL(CategoryId, 0), SUM(Price) FROM " + currentTableName + " GROUP BY 1;";
+    if (prepare(detailedDB, sql, &stmt) == SQLITE_OK) {
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            double total = sqlite3_column_double(stmt, 1);
+            spentByCategory[sqlite3_column_int(stmt, 0)] = total;
+            spent += total;
+        }
+    }
+    sqlite3_finalize(stmt);
+
+    std::unordered_map<int, std::pair<std::string, double>> categoryLimits;
+    sql = "SELECT l.category_id, c.name, l.limit_amount FROM CategoryLimits l JOIN Categories c ON c.id = l.category_id;";
+    if (prepare(mainDB, sql, &stmt) == SQLITE_OK) {
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            const char* name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+            categoryLimits[sqlite3_column_int(stmt, 0)] = {name ? name : "", sqlite3_column_double(stmt, 2)};
+        }
+    }
+    sqlite3_finalize(stmt);
+
+    budget.load(currentYearMonth, getCurrentMonthSummary().limit, spent, spentByCategory, categoryLimits);
+}
+
+bool FinanceDB::readAmount(int id, double& price, int& categoryId) {
+    std::string sql = "SELECT Price, IFNULL(CategoryId, 0) FROM " + currentTableName + " WHERE rowid = ?;";
+    sqlite3_stmt* stmt;
+    bool found = false;
+    if (prepare(detailedDB, sql, &stmt) == SQLITE_OK) {
+        sqlite3_bind_int(stmt, 1, id);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            price = sqlite3_column_double(stmt, 0);
+            categoryId = sqlite3_column_int(stmt, 1);
+            found = true;
+        }
+    }
+    sqlite3_finalize(stmt);
+    return found;
+}
+
+bool FinanceDB::readNames(int id, std::string& spentOn, int& categoryId, int& modeOfPaymentId) {
+    std::string sql = "SELECT SpentOn, IFNULL(CategoryId, 0), IFNULL(ModeOfPaymentId, 0) FROM " + currentTableName + " WHERE rowid = ?;";
+    sqlite3_stmt* stmt;
+    bool found = false;
+    if (prepare(detailedDB, sql, &stmt) == SQLITE_OK) {
+        sqlite3_bind_int(stmt, 1, id);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            const unsigned char* text = sqlite3_column_text(stmt, 0);
+            spentOn = text ? reinterpret_cast<const char*>(text) : "";
+            categoryId = sqlite3_column_int(stmt, 1);
+            modeOfPaymentId = sqlite3_column_int(stmt, 2);
+            found = true;
+        }
+    }
+    sqlite3_finalize(stmt);
+    return found;
+}
+
+void FinanceDB::recordIdUse(SuggestKind kind, int id, int delta) {
+    if (id == 0) return;
+    auto names = kind == SuggestKind::Category ? categoriesCache.get() : modesCache.get();
+    suggestIndex.recordUse(kind, names->name(id), delta);
+}
+
+void FinanceDB::notifyChange(ChangeKind kind, int id) {
+    countChangeLogWrite();
+    if (!changeListener) return;
+    if (batchOpen) {
+        pendingChanges.emplace_back(kind, id);
+        return;
+    }
+    publishChange(kind, id);
+}
+
+void FinanceDB::publishChange(ChangeKind kind, int id) {
+    ExpenseChange change{kind, {}, 0.0};
+    change.record.id = id;
+    if (kind != ChangeKind::Delete) {
+        std::string sql = "SELECT " + EXPENSE_COLUMNS + " FROM " + currentTableName + " WHERE rowid = ?;";
+        sqlite3_stmt* stmt;
+        bool found = false;
+        if (prepare(detailedDB, sql, &stmt) == SQLITE_OK) {
+            sqlite3_bind_int(stmt, 1, id);
+            if (sqlite3_step(stmt) == SQLITE_ROW) {
+                change.record = readExpenseRecord(stmt);
+                found = true;
+            }
+        }
+        sqlite3_finalize(stmt);
+        if (!found) return;
+    }
+    change.monthTotal = budget.spent();
+    changeListener(change);
+}
+
+void FinanceDB::countChangeLogWrite() {
+    if (++changeLogWrites % CHANGE_LOG_SEGMENT == 0) compactChangeLog();
+}
+
+void FinanceDB::compactChangeLog() {
+    if (!detailedDB) return;
+    std::lock_guard<std::recursive_mutex> lock(writeMutex);
+
+    long long latest = 0;
+    long long count = 0;
+    sqlite3_stmt* stmt;
+    if (prepare(detailedDB, "SELECT IFNULL(MAX(seq), 0), COUNT(*) FROM ChangeLog;", &stmt) == SQLITE_OK &&
+        sqlite3_step(stmt) == SQLITE_ROW) {
+        latest = sqlite3_column_int64(stmt, 0);
+        count = sqlite3_column_int64(stmt, 1);
+    }
+    sqlite3_finalize(stmt);
+
+    // In cold segments an entry is redundant once a newer one exists for the
+    // same row: inserts and updates log the whole row, so the newest entry
+    // alone brings a reader to the current state
+    int folded = 0;
+    long long cold = (latest / CHANGE_LOG_SEGMENT - CHANGE_LOG_HOT_SEGMENTS) * CHANGE_LOG_SEGMENT;
+    if (cold > 0) {
+        std::string sql = "DELETE FROM ChangeLog WHERE seq <= ? AND EXISTS (SELECT 1 FROM ChangeLog AS newer "
+                          "WHERE newer.month = ChangeLog.month AND newer.row_id = ChangeLog.row_id AND newer.seq > ChangeLog.seq);";
+        if (prepare(detailedDB, sql, &stmt) == SQLITE_OK) {
+            sqlite3_bind_int64(stmt, 1, cold);
+            if (sqlite3_step(stmt) == SQLITE_DONE) folded = sqlite3_changes(detailedDB);
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    // Past the bound the oldest entries go regardless; SQLite reuses their
+    // pages, so the file stops growing once the log is at its bound
+    long long cutoff = 0;
+    if (count - folded > CHANGE_LOG_MAX_ENTRIES) {
+        if (prepare(detailedDB, "SELECT seq FROM ChangeLog ORDER BY seq LIMIT 1 OFFSET ?;", &stmt) == SQLITE_OK) {
+            sqlite3_bind_int64(stmt, 1, count - folded - CHANGE_LOG_MAX_ENTRIES - 1);
+            if (sqlite3_step(stmt) == SQLITE_ROW) cutoff = sqlite3_column_int64(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+    }
+    if (cutoff > 0) {
+        std::string cut = std::to_string(cutoff);
+        executeSQL(detailedDB, "DELETE FROM ChangeLog WHERE seq <= " + cut + ";");
+        executeSQL(detailedDB, "UPDATE ChangeLogState SET truncated_through = MAX(truncated_through, " + cut + ") WHERE id = 1;");
+    }
+    if (folded > 0 || cutoff > 0) {
+        logInfo("Change log compacted").field("folded", folded).field("truncated_through", cutoff).field("latest", latest);
+    }
+}
+
+ChangeLogPage FinanceDB::getChangesSince(long long since, size_t limit) {
+    ChangeLogPage page{{}, 0, false};
+    if (!detailedDB) return page;
+
+    ReadPool::Lease reader = readers.lease(detailedDB);
+    sqlite3_stmt* stmt;
+    std::string sql = "SELECT (SELECT IFNULL(MAX(seq), 0) FROM ChangeLog), truncated_through FROM ChangeLogState WHERE id = 1;";
+    if (prepare(reader.db(), sql, &stmt) == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW) {
+        page.latest = sqlite3_column_int64(stmt, 0);
+        page.truncated = since < sqlite3_column_int64(stmt, 1);
+    }
+    sqlite3_finalize(stmt);
+    if (page.truncated) return page;
+
+    sql = "SELECT seq, op, month, row_id, IFNULL(day_month_year, ''), IFNULL(SpentOn, ''), IFNULL(Price, 0), "
+          "IFNULL(CategoryId, 0), IFNULL(ModeOfPaymentId, 0), changed_at FROM ChangeLog WHERE seq > ? ORDER BY seq LIMIT ?;";
+    if (prepare(reader.db(), sql, &stmt) == SQLITE_OK) {
+        sqlite3_bind_int64(stmt, 1, since);
+        sqlite3_bind_int64(stmt, 2, static_cast<sqlite3_int64>(limit));
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            ChangeLogEntry entry;
+            entry.seq = sqlite3_column_int64(stmt, 0);
+            entry.op = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+            entry.month = sqlite3_column_int(stmt, 2);
+            entry.record.id = sqlite3_column_int(stmt, 3);
+            entry.record.day_month_year = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4));
+            entry.record.spent_on = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
+            entry.record.price = sqlite3_column_double(stmt, 6);
+            entry.record.category_id = sqlite3_column_int(stmt, 7);
+            entry.record.mode_of_payment_id = sqlite3_column_int(stmt, 8);
+            entry.record.priority = 0;
+            entry.at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 9));
+            page.entries.push_back(std::move(entry));
+        }
+    } else {
+        logError("Failed to prepare statement for getChangesSince").field("error", sqlite3_errmsg(reader.db()));
+    }
+    sqlite3_finalize(stmt);
+    return page;
+}
+
+std::vector<BackupStats> FinanceDB::backupTo(const std::string& directory) {
+    std::vector<BackupStats> stats = {backupDatabase(mainDB, directory + "/Main.db", "Main.db"),
+                                      backupDatabase(detailedDB, directory + "/Detailed.db", "Detailed.db")};
+    if (archiveAttached) stats.push_back(backupDatabase(detailedDB, directory + "/Archive.db", "Archive.db", "archive"));
+    return stats;
+}
+
+// Copies one month table into the archive, rowids included so expense ids
+// stay valid, then drops the live table once the copy is checked. Writers are
+// held off on writeMutex throughout, so nothing can change the month between
+// the copy and the drop. SQLite commits attached WAL databases one file after
+// the other, main first, so the copy is made durable on its own before the
+// drop: a run cut short in between leaves the month in both files, where the
+// live table shadows the copy, and the next run copies it again.
+bool FinanceDB::archiveMonth(const std::string& table, long long& rows) {
+    static const std::string COLUMNS = "day_month_year, SpentOn, Price, CategoryId, ModeOfPaymentId, Priority";
+    std::lock_guard<std::recursive_mutex> lock(writeMutex);
+    std::string month = std::to_string(tableMonth(table));
+    if (!executeSQL(detailedDB, "BEGIN;")) return false;
+    bool copied = executeSQL(detailedDB, "DROP TABLE IF EXISTS archive." + table + ";") &&
+                  executeSQL(detailedDB, "CREATE TABLE archive." + table + " " + MONTH_TABLE_COLUMNS + ";") &&
+                  executeSQL(detailedDB, "INSERT INTO archive." + table + " (rowid, " + COLUMNS + ") SELECT rowid, " + COLUMNS +
+                                             " FROM main." + table + ";") &&
+                  executeSQL(detailedDB, "COMMIT;");
+    if (!copied) {
+        executeSQL(detailedDB, "ROLLBACK;");
+        return false;
+    }
+
+    // The check, the drop and the rollup commit together or not at all
+    if (!executeSQL(detailedDB, "BEGIN;")) return false;
+    long long live = -1, archived = -1;
+    sqlite3_stmt* stmt;
+    if (prepare(detailedDB, "SELECT (SELECT COUNT(*) FROM main." + table + "), (SELECT COUNT(*) FROM archive." + table + ");",
+                &stmt) == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW) {
+        live = sqlite3_column_int64(stmt, 0);
+        archived = sqlite3_column_int64(stmt, 1);
+    }
+    sqlite3_finalize(stmt);
+    if (live < 0 || live != archived) {
+        logError("Month not archived, copy incomplete").field("table", table).field("rows", live).field("copied", archived);
+        executeSQL(detailedDB, "ROLLBACK;");
+        return false;
+    }
+
+    // The Price index and the triggers go with the table; field clocks only
+    // matter for the current month
+    bool moved = executeSQL(detailedDB, "DROP TABLE main." + table + ";") &&
+                 executeSQL(detailedDB, "DELETE FROM FieldClock WHERE month = " + month + ";") &&
+                 executeSQL(detailedDB, "INSERT OR REPLACE INTO archive.ArchivedMonths (month, rows, total) "
+                                        "SELECT " + month + ", COUNT(*), IFNULL(SUM(Price), 0) FROM archive." + table + ";") &&
+                 executeSQL(detailedDB, "COMMIT;");
+    if (!moved) {
+        executeSQL(detailedDB, "ROLLBACK;");
+        return false;
+    }
+    rows = archived;
+    return true;
+}
+
+ArchiveResult FinanceDB::archiveOldMonths(int keepMonths) {
+    ArchiveResult result{true, {}, 0, false};
+    if (!detailedDB || !archiveAttached || keepMonths < 1) return result;
+
+    // Months counted from year 0, so the cutoff can cross a year boundary
+    auto monthNumber = [](int month) { return month / 100 * 12 + month % 100 - 1; };
+    int cutoff = monthNumber(currentMonth) - keepMonths;
+    auto start = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::recursive_mutex> lock(writeMutex);
+    for (const auto& table : listExpenseTables(false)) {
+        int month = tableMonth(table);
+        if (month == 0 || monthNumber(month) >= cutoff) continue;
+        long long rows = 0;
+        if (archiveMonth(table, rows)) {
+            result.months.push_back(month);
+            result.rows += rows;
+        } else {
+            result.ok = false;
+        }
+    }
+    if (result.months.empty()) return result;
+
+    // Dropped tables leave free pages that SQLite only reuses; VACUUM rebuilds
+    // the file without them. It refuses while another statement is running on
+    // the connection, and then the pages are just reused by later writes.
+    char* errMsg = nullptr;
+    if (sqlite3_exec(detailedDB, "VACUUM main;", 0, 0, &errMsg) == SQLITE_OK) {
+        result.vacuumed = true;
+        // The rebuilt file went through the WAL; empty it again
+        executeSQL(detailedDB, "PRAGMA main.wal_checkpoint(TRUNCATE);");
+    } else {
+        logWarn("Detailed DB not vacuumed after archiving").field("error", errMsg ? errMsg : "");
+        sqlite3_free(errMsg);
+    }
+    // Archived months are only read from now on, so move them out of the WAL
+    // into the archive file itself
+    executeSQL(detailedDB, "PRAGMA archive.wal_checkpoint(TRUNCATE);");
+    logInfo("Months archived")
+        .field("months", result.months.size())
+        .field("rows", result.rows)
+        .field("vacuumed", result.vacuumed ? "true" : "false")
+        .field("ms", std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    return result;
+}
+
+std::vector<ArchivedMonth> FinanceDB::getArchivedMonths() {
+    std::vector<ArchivedMonth> months;
+    if (!archiveAttached) return months;
+    ReadPool::Lease reader = readers.lease(detailedDB);
+    sqlite3_stmt* stmt;
+    if (prepare(reader.db(), "SELECT month, rows, total, archived_at FROM archive.ArchivedMonths ORDER BY month;", &stmt) == SQLITE_OK) {
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            months.push_back({sqlite3_column_int(stmt, 0), sqlite3_column_int64(stmt, 1), sqlite3_column_double(stmt, 2),
+                              reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3))});
+        }
+    }
+    sqlite3_finalize(stmt);
+    return months;
+}
+
+long long FinanceDB::latestChangeSeq() {
+    long long latest = 0;
+    if (!detailedDB) return latest;
+    ReadPool::Lease reader = readers.lease(detailedDB);
+    sqlite3_stmt* stmt;
+    if (prepare(reader.db(), "SELECT IFNULL(MAX(seq), 0) FROM ChangeLog;", &stmt) == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW) {
+        latest = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return latest;
+}
+
+std::vector<SyncResult> FinanceDB::applySync(const std::string& clientId, const std::vector<SyncMutation>& mutations) {
+    std::vector<SyncResult> results;
+    if (!detailedDB) {
+        for (const auto& mutation : mutations) results.push_back({mutation.mutationId, "failed", 0, {}});
+        return results;
+    }
+
+    // One transaction makes the batch durable at once, with a single journal
+    // sync instead of one per write. Other writers wait on writeMutex, so
+    // nothing but the batch is in it. A mutation that fails is reported and
+    // the rest still apply; only a failed COMMIT undoes the batch.
+    std::lock_guard<std::recursive_mutex> lock(writeMutex);
+    if (!executeSQL(detailedDB, "BEGIN;")) {
+        for (const auto& mutation : mutations) results.push_back({mutation.mutationId, "failed", 0, {}});
+        return results;
+    }
+    sqlite3_stmt* stmt;
+    if (prepare(detailedDB, "DELETE FROM SyncApplied WHERE applied_at < " + NOW_MS_SQL + " - ?;", &stmt) == SQLITE_OK) {
+        sqlite3_bind_int64(stmt, 1, SYNC_REPLAY_WINDOW_MS);
+        sqlite3_step(stmt);
+    }
+    sqlite3_finalize(stmt);
+    // Listeners hear of the batch's writes only once they are durable
+    batchOpen = true;
+    for (const auto& mutation : mutations) {
+        results.push_back(applyMutation(clientId, mutation));
+    }
+    batchOpen = false;
+    std::vector<std::pair<ChangeKind, int>> changes;
+    changes.swap(pendingChanges);
+    if (executeSQL(detailedDB, "COMMIT;")) {
+        for (const auto& change : changes) publishChange(change.first, change.second);
+        return results;
+    }
+
+    // Nothing of the batch is kept, SyncApplied included, so the client
+    // sends it again. The in-memory mirrors already counted its writes.
+    executeSQL(detailedDB, "ROLLBACK;");
+    logError("Sync batch rolled back").field("client", clientId).field("mutations", mutations.size());
+    for (auto& result : results) {
+        if (result.id > 0) reloadRow(result.id);
+        result = {result.mutationId, "failed", 0, {}};
+    }
+    loadBudget();
+    return results;
+}
+
+// Brings the analytics snapshot in line with the stored row after a rollback
+void FinanceDB::reloadRow(int id) {
+    if (!analyticsEnabled) return;
+    std::string sql = "SELECT " + EXPENSE_COLUMNS + " FROM " + currentTableName + " WHERE rowid = ?;";
+    sqlite3_stmt* stmt;
+    if (prepare(detailedDB, sql, &stmt) == SQLITE_OK) {
+        sqlite3_bind_int(stmt, 1, id);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            ExpenseRecord e = readExpenseRecord(stmt);
+            analytics.upsert(currentMonth, id, e.day_month_year, e.spent_on, e.price, e.category_id, e.mode_of_payment_id);
+        } else {
+            analytics.remove(currentMonth, id);
+        }
+    }
+    sqlite3_finalize(stmt);
+}
+
+SyncResult FinanceDB::applyMutation(const std::string& clientId, const SyncMutation& mutation) {
+    SyncResult result{mutation.mutationId, "failed", 0, {}};
+    sqlite3_stmt* stmt;
+
+    // Sent before: answer as the first time
+    std::string sql = "SELECT status, row_id FROM SyncApplied WHERE client_id = ? AND mutation_id = ?;";
+    if (prepare(detailedDB, sql, &stmt) == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, clientId.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 2, mutation.mutationId.c_str(), -1, SQLITE_STATIC);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            result.status = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+            result.id = sqlite3_column_int(stmt, 1);
+            sqlite3_finalize(stmt);
+            return result;
+        }
+    }
+    sqlite3_finalize(stmt);
+
+    std::vector<const char*> won;
+    if (mutation.kind == ChangeKind::Insert) {
+        if (!mutation.spentOn || !mutation.price ||
+            !addExpense(*mutation.spentOn, *mutation.price, mutation.category, mutation.date, mutation.modeOfPayment, &result.id)) {
+            return result;
+        }
+        // Fields left out were still written (as defaults) at the client's time
+        won = {"date", "spent_on", "price", "category", "mode_of_payment"};
+        result.status = "applied";
+    } else {
+        double oldPrice = 0.0;
+        int oldCategoryId = 0;
+        result.id = mutation.id;
+        if (!readAmount(mutation.id, oldPrice, oldCategoryId)) {
+            // Already deleted; an edit never brings a row back
+            result.status = mutation.kind == ChangeKind::Delete ? "applied" : "conflict";
+        } else {
+            std::map<std::string, std::pair<long long, std::string>> clocks;
+            sql = "SELECT field, ts, client_id FROM FieldClock WHERE month = ? AND row_id = ?;";
+            if (prepare(detailedDB, sql, &stmt) == SQLITE_OK) {
+                sqlite3_bind_int(stmt, 1, currentMonth);
+                sqlite3_bind_int(stmt, 2, mutation.id);
+                while (sqlite3_step(stmt) == SQLITE_ROW) {
+                    clocks[reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0))] = {
+                        sqlite3_column_int64(stmt, 1), reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2))};
+                }
+            }
+            sqlite3_finalize(stmt);
+            auto newer = [&](const std::pair<long long, std::string>& clock) {
+                return clock.first > mutation.ts || (clock.first == mutation.ts && clock.second > clientId);
+            };
+
+            if (mutation.kind == ChangeKind::Delete) {
+                // Loses to any field written after it
+                for (const auto& clock : clocks) {
+                    if (newer(clock.second)) result.lostFields.push_back(clock.first);
+                }
+                if (!result.lostFields.empty()) {
+                    result.status = "conflict";
+                } else if (deleteSelected(mutation.id)) {
+                    result.status = "applied";
+                } else {
+                    return result;
+                }
+            } else {
+                std::optional<std::string> spentOn, category, modeOfPayment, date;
+                std::optional<double> price;
+                auto take = [&](const auto& value, auto& into, const char* field) {
+                    if (!value) return;
+                    auto clock = clocks.find(field);
+                    if (clock != clocks.end() && newer(clock->second)) {
+                        result.lostFields.push_back(field);
+                    } else {
+                        into = value;
+                        won.push_back(field);
+                    }
+                };
+                take(mutation.date, date, "date");
+                take(mutation.spentOn, spentOn, "spent_on");
+                take(mutation.price, price, "price");
+                take(mutation.category, category, "category");
+                take(mutation.modeOfPayment, modeOfPayment, "mode_of_payment");
+
+                if (won.empty()) {
+                    result.status = "conflict";
+                } else if (updateSelected3(mutation.id, spentOn, price, category, modeOfPayment, date, std::nullopt)) {
+                    result.status = result.lostFields.empty() ? "applied" : "partial";
+                } else {
+                    return result;
+                }
+            }
+        }
+    }
+
+    // The triggers stamped the written fields with the server's clock; the
+    // write happened at the client's
+    sql = "INSERT OR REPLACE INTO FieldClock (month, row_id, field, ts, client_id) VALUES (?, ?, ?, ?, ?);";
+    if (!won.empty() && prepare(detailedDB, sql, &stmt) == SQLITE_OK) {
+        for (const char* field : won) {
+            sqlite3_bind_int(stmt, 1, currentMonth);
+            sqlite3_bind_int(stmt, 2, result.id);
+            sqlite3_bind_text(stmt, 3, field, -1, SQLITE_STATIC);
+            sqlite3_bind_int64(stmt, 4, mutation.ts);
+            sqlite3_bind_text(stmt, 5, clientId.c_str(), -1, SQLITE_STATIC);
+            if (sqlite3_step(stmt) != SQLITE_DONE) {
+                logError("Failed to stamp synced field").field("field", field).field("error", sqlite3_errmsg(detailedDB));
+            }
+            sqlite3_reset(stmt);
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    sql = "INSERT INTO SyncApplied (client_id, mutation_id, status, row_id, applied_at) VALUES (?, ?, ?, ?, " + NOW_MS_SQL + ");";
+    if (prepare(detailedDB, sql, &stmt) == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, clientId.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 2, mutation.mutationId.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 3, result.status.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 4, result.id);
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            logError("Failed to record synced mutation").field("mutation", mutation.mutationId).field("error", sqlite3_errmsg(detailedDB));
+        }
+    }
+    sqlite3_finalize(stmt);
+    return result;
+}
+
+bool FinanceDB::setCategoryLimit(const std::string& category, double limit) {
+    if (!mainDB || category.empty() || limit < 0) return false;
+    int categoryId = resolveCategoryId(category);
+    if (categoryId == 0) return false;
+
+    std::string sql = limit > 0 ? "INSERT INTO CategoryLimits (category_id, limit_amount) VALUES (?, ?) "
+                                  "ON CONFLICT(category_id) DO UPDATE SET limit_amount=excluded.limit_amount;"
+                                : "DELETE FROM CategoryLimits WHERE category_id = ?;";
+    sqlite3_stmt* stmt;
+    if (prepare(mainDB, sql, &stmt) != SQLITE_OK) {
+        logError("Failed to prepare statement for setCategoryLimit").field("error", sqlite3_errmsg(mainDB));
+        return false;
+    }
+    sqlite3_bind_int(stmt, 1, categoryId);
+    if (limit > 0) sqlite3_bind_double(stmt, 2, limit);
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        logError("Execution failed for setCategoryLimit").field("error", sqlite3_errmsg(mainDB));
+        sqlite3_finalize(stmt);
+        return false;
+    }
+    sqlite3_finalize(stmt);
+    budget.setCategoryLimit(categoryId, category, limit);
+    return true;
+}
+
+std::vector<CategoryLimit> FinanceDB::getCategoryLimits() {
+    std::vector<CategoryLimit> limits;
+    if (!mainDB) return limits;
+
+    std::string sql = "SELECT l.category_id, c.name, l.limit_amount FROM CategoryLimits l "
+                      "JOIN Categories c ON c.id = l.category_id ORDER BY c.name;";
+    sqlite3_stmt* stmt;
+    if (prepare(mainDB, sql, &stmt) == SQLITE_OK) {
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            const char* name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+            limits.push_back({name ? name : "", sqlite3_column_double(stmt, 2), budget.categorySpent(sqlite3_column_int(stmt, 0))});
+        }
+    }
+    sqlite3_finalize(stmt);
+    return limits;
+}
+
 double FinanceDB::calcTotalSpent() {
+    if (useAnalytics()) return analytics.totalForMonth(currentMonth);
+
     double total=0.0;
     std::string sql = "SELECT SUM(Price) FROM "+currentTableName+";";
+    ReadPool::Lease reader = readers.lease(detailedDB);
     sqlite3_stmt* stmt;
 
-    if (sqlite3_prepare_v2(detailedDB, sql.c_str(), -1, &stmt, 0) == SQLITE_OK) {
+    if (prepare(reader.db(), sql, &stmt) == SQLITE_OK) {
         if (sqlite3_step(stmt) == SQLITE_ROW) {
             total=sqlite3_column_double(stmt,0);
         }
     } else {
-        std::cerr << "Failed to prepare statement for calcTotalSpent: " << sqlite3_errmsg(detailedDB) << std::endl;
+        logError("Failed to prepare statement for calcTotalSpent").field("error", sqlite3_errmsg(reader.db()));
     }
     sqlite3_finalize(stmt);
     return total;
@@ -473,24 +1722,40 @@ double FinanceDB::calcTotalSpent() {
 
 bool FinanceDB::deleteSelected(int id) {
     if (!detailedDB) return false;
+    std::lock_guard<std::recursive_mutex> lock(writeMutex);
+
+    double oldPrice = 0.0;
+    int oldCategoryId = 0;
+    bool existed = readAmount(id, oldPrice, oldCategoryId);
+    std::string oldSpentOn;
+    int oldModeId = 0;
+    existed = existed && readNames(id, oldSpentOn, oldCategoryId, oldModeId);
 
     std::string sql = "DELETE FROM " + currentTableName + " WHERE rowid = ?;";
     sqlite3_stmt* stmt;
 
-    if (sqlite3_prepare_v2(detailedDB, sql.c_str(), -1, &stmt, 0) != SQLITE_OK) {
-        std::cerr << "Failed to prepare statement for deleteSelected: " << sqlite3_errmsg(detailedDB) << std::endl;
+    if (prepare(detailedDB, sql, &stmt) != SQLITE_OK) {
+        logError("Failed to prepare statement for deleteSelected").field("error", sqlite3_errmsg(detailedDB));
         return false;
     }
 
     sqlite3_bind_int(stmt, 1, id);
 
     if (sqlite3_step(stmt) != SQLITE_DONE) {
-        std::cerr << "Execution failed for deleteSelected: " << sqlite3_errmsg(detailedDB) << std::endl;
+        logError("Execution failed for deleteSelected").field("error", sqlite3_errmsg(detailedDB));
         sqlite3_finalize(stmt);
         return false;
     }
 
     sqlite3_finalize(stmt);
+    if (analyticsEnabled) analytics.remove(currentMonth, id);
+    if (existed) {
+        budget.record(oldCategoryId, -oldPrice);
+        suggestIndex.recordUse(SuggestKind::Item, oldSpentOn, -1);
+        recordIdUse(SuggestKind::Category, oldCategoryId, -1);
+        recordIdUse(SuggestKind::ModeOfPayment, oldModeId, -1);
+        notifyChange(ChangeKind::Delete, id);
+    }
     return true;
 }
 
@@ -498,6 +1763,7 @@ bool FinanceDB::updateSelected2(int id, const std::optional<std::string>& spentO
                                const std::optional<double>& price,
                                const std::optional<int>& priority) {
     if (!detailedDB) return false;
+    std::lock_guard<std::recursive_mutex> lock(writeMutex);
 
     std::vector<std::string> update_clauses;
     std::vector<std::function<void(sqlite3_stmt*, int)>> binders;
@@ -516,7 +1782,7 @@ bool FinanceDB::updateSelected2(int id, const std::optional<std::string>& spentO
     }
 
     if (update_clauses.empty()) {
-        std::cerr << "No fields provided for update for id: " << id << std::endl;
+        logWarn("No fields provided for update").field("id", id);
         return false;
     }
 
@@ -528,11 +1794,18 @@ bool FinanceDB::updateSelected2(int id, const std::optional<std::string>& spentO
         }
     }
 
+    double oldPrice = 0.0;
+    int oldCategoryId = 0;
+    bool existed = price && readAmount(id, oldPrice, oldCategoryId);
+    std::string oldSpentOn;
+    int oldNameCategoryId = 0, oldModeId = 0;
+    bool renamed = spentOn && readNames(id, oldSpentOn, oldNameCategoryId, oldModeId);
+
     std::string sql = "UPDATE " + currentTableName + " SET " + set_clause + " WHERE rowid = ?;";
     sqlite3_stmt* stmt = nullptr;
 
-    if (sqlite3_prepare_v2(detailedDB, sql.c_str(), -1, &stmt, 0) != SQLITE_OK) {
-        std::cerr << "Failed to prepare statement for updateSelected2: " << sqlite3_errmsg(detailedDB) << std::endl;
+    if (prepare(detailedDB, sql, &stmt) != SQLITE_OK) {
+        logError("Failed to prepare statement for updateSelected2").field("error", sqlite3_errmsg(detailedDB));
         return false;
     }
 
@@ -544,12 +1817,19 @@ bool FinanceDB::updateSelected2(int id, const std::optional<std::string>& spentO
     sqlite3_bind_int(stmt, param_index, id);
 
     if (sqlite3_step(stmt) != SQLITE_DONE) {
-        std::cerr << "Execution failed for updateSelected2: " << sqlite3_errmsg(detailedDB) << std::endl;
+        logError("Execution failed for updateSelected2").field("error", sqlite3_errmsg(detailedDB));
         sqlite3_finalize(stmt);
         return false;
     }
 
     sqlite3_finalize(stmt);
+    if (analyticsEnabled) analytics.update(currentMonth, id, std::nullopt, spentOn, price, std::nullopt, std::nullopt);
+    if (existed) budget.replace(oldCategoryId, oldPrice, oldCategoryId, *price);
+    if (renamed) {
+        suggestIndex.recordUse(SuggestKind::Item, oldSpentOn, -1);
+        suggestIndex.recordUse(SuggestKind::Item, *spentOn);
+    }
+    notifyChange(ChangeKind::Update, id);
     return true;
 }
 
@@ -560,6 +1840,7 @@ bool FinanceDB::updateSelected3(int id, const std::optional<std::string>& spentO
                                const std::optional<std::string>& date,
                                const std::optional<int>& priority) {
     if (!detailedDB) return false;
+    std::lock_guard<std::recursive_mutex> lock(writeMutex);
 
     std::vector<std::string> update_clauses;
     std::vector<std::function<void(sqlite3_stmt*, int)>> binders;
@@ -572,20 +1853,22 @@ bool FinanceDB::updateSelected3(int id, const std::optional<std::string>& spentO
         update_clauses.push_back("Price = ?");
         binders.push_back([&](sqlite3_stmt* stmt, int idx) { sqlite3_bind_double(stmt, idx, *price); });
     }
+    int categoryId = (category && !category->empty()) ? resolveCategoryId(*category) : 0;
     if (category) {
-        if (category->empty()) {
-            update_clauses.push_back("Category = NULL");
+        if (categoryId == 0) {
+            update_clauses.push_back("CategoryId = NULL");
         } else {
-            update_clauses.push_back("Category = ?");
-            binders.push_back([&](sqlite3_stmt* stmt, int idx) { sqlite3_bind_text(stmt, idx, category->c_str(), -1, SQLITE_STATIC); });
+            update_clauses.push_back("CategoryId = ?");
+            binders.push_back([&](sqlite3_stmt* stmt, int idx) { sqlite3_bind_int(stmt, idx, categoryId); });
         }
     }
+    int modeOfPaymentId = (modeOfPayment && !modeOfPayment->empty()) ? resolveModeOfPaymentId(*modeOfPayment) : 0;
     if (modeOfPayment) {
-        if (modeOfPayment->empty()) {
-            update_clauses.push_back("ModeOfPayment = NULL");
+        if (modeOfPaymentId == 0) {
+            update_clauses.push_back("ModeOfPaymentId = NULL");
         } else {
-            update_clauses.push_back("ModeOfPayment = ?");
-            binders.push_back([&](sqlite3_stmt* stmt, int idx) { sqlite3_bind_text(stmt, idx, modeOfPayment->c_str(), -1, SQLITE_STATIC); });
+            update_clauses.push_back("ModeOfPaymentId = ?");
+            binders.push_back([&](sqlite3_stmt* stmt, int idx) { sqlite3_bind_int(stmt, idx, modeOfPaymentId); });
         }
     }
     if (date) {
@@ -598,7 +1881,7 @@ bool FinanceDB::updateSelected3(int id, const std::optional<std::string>& spentO
     }
 
     if (update_clauses.empty()) {
-        std::cerr << "No fields provided for update for id: " << id << std::endl;
+        logWarn("No fields provided for update").field("id", id);
         return false;
     }
 
@@ -610,11 +1893,18 @@ bool FinanceDB::updateSelected3(int id, const std::optional<std::string>& spentO
         }
     }
 
+    double oldPrice = 0.0;
+    int oldCategoryId = 0;
+    bool existed = (price || category) && readAmount(id, oldPrice, oldCategoryId);
+    std::string oldSpentOn;
+    int oldNameCategoryId = 0, oldModeId = 0;
+    bool named = (spentOn || category || modeOfPayment) && readNames(id, oldSpentOn, oldNameCategoryId, oldModeId);
+
     std::string sql = "UPDATE " + currentTableName + " SET " + set_clause + " WHERE rowid = ?;";
     sqlite3_stmt* stmt = nullptr;
 
-    if (sqlite3_prepare_v2(detailedDB, sql.c_str(), -1, &stmt, 0) != SQLITE_OK) {
-        std::cerr << "Failed to prepare statement for updateSelected3: " << sqlite3_errmsg(detailedDB) << std::endl;
+    if (prepare(detailedDB, sql, &stmt) != SQLITE_OK) {
+        logError("Failed to prepare statement for updateSelected3").field("error", sqlite3_errmsg(detailedDB));
         return false;
     }
 
@@ -626,29 +1916,71 @@ bool FinanceDB::updateSelected3(int id, const std::optional<std::string>& spentO
     sqlite3_bind_int(stmt, param_index, id);
 
     if (sqlite3_step(stmt) != SQLITE_DONE) {
-        std::cerr << "Execution failed for updateSelected3: " << sqlite3_errmsg(detailedDB) << std::endl;
+        logError("Execution failed for updateSelected3").field("error", sqlite3_errmsg(detailedDB));
         sqlite3_finalize(stmt);
         return false;
     }
 
     sqlite3_finalize(stmt);
+
+    if (analyticsEnabled) {
+        analytics.update(currentMonth, id, date, spentOn, price,
+                         category ? std::optional<int>(categoryId) : std::nullopt,
+                         modeOfPayment ? std::optional<int>(modeOfPaymentId) : std::nullopt);
+    }
+    if (existed) budget.replace(oldCategoryId, oldPrice, category ? categoryId : oldCategoryId, price ? *price : oldPrice);
+
+    // Only a row that was there had names to take back
+    if (named && spentOn) suggestIndex.recordUse(SuggestKind::Item, oldSpentOn, -1);
+    if (named && category) recordIdUse(SuggestKind::Category, oldNameCategoryId, -1);
+    if (named && modeOfPayment) recordIdUse(SuggestKind::ModeOfPayment, oldModeId, -1);
+    if (spentOn) suggestIndex.recordUse(SuggestKind::Item, *spentOn);
+    if (category && !category->empty()) suggestIndex.recordUse(SuggestKind::Category, *category);
+    if (modeOfPayment && !modeOfPayment->empty()) suggestIndex.recordUse(SuggestKind::ModeOfPayment, *modeOfPayment);
+    notifyChange(ChangeKind::Update, id);
     return true;
 }
 
-std::vector<std::string> FinanceDB::getAllCategories() {
-    std::vector<std::string> categories;
-    if (!mainDB) return categories;
+std::vector<std::pair<int, std::string>> FinanceDB::queryNames(const std::string& table) {
+    std::vector<std::pair<int, std::string>> rows;
+    if (!mainDB) return rows;
 
-    std::string sql = "SELECT name FROM Categories ORDER BY name;";
+    std::string sql = "SELECT id, name FROM " + table + " ORDER BY name;";
     sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(mainDB, sql.c_str(), -1, &stmt, 0) == SQLITE_OK) {
+    if (prepare(mainDB, sql, &stmt) == SQLITE_OK) {
         while (sqlite3_step(stmt) == SQLITE_ROW) {
-            const char* name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
-            if (name) categories.push_back(name);
+            const char* name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+            if (name) rows.emplace_back(sqlite3_column_int(stmt, 0), name);
         }
     }
     sqlite3_finalize(stmt);
-    return categories;
+    return rows;
+}
+
+// Dictionary id for a category, registering the category first if needed.
+// Returns 0 if it can't be stored.
+int FinanceDB::resolveCategoryId(const std::string& category) {
+    int id = categoriesCache.get()->id(category);
+    if (id == 0 && addCategory(category)) {
+        id = categoriesCache.get()->id(category);
+    }
+    return id;
+}
+
+int FinanceDB::resolveModeOfPaymentId(const std::string& modeOfPayment) {
+    int id = modesCache.get()->id(modeOfPayment);
+    if (id == 0 && addModeOfPayment(modeOfPayment)) {
+        id = modesCache.get()->id(modeOfPayment);
+    }
+    return id;
+}
+
+std::vector<std::string> FinanceDB::getAllCategories() {
+    return categoriesCache.get()->names;
+}
+
+std::shared_ptr<const RefDataSnapshot> FinanceDB::getCategoriesSnapshot() const {
+    return categoriesCache.get();
 }
 
 bool FinanceDB::addCategory(const std::string& category) {
@@ -656,29 +1988,24 @@ bool FinanceDB::addCategory(const std::string& category) {
 
     std::string sql = "INSERT OR IGNORE INTO Categories (name) VALUES (?);";
     sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(mainDB, sql.c_str(), -1, &stmt, 0) != SQLITE_OK) {
+    if (prepare(mainDB, sql, &stmt) != SQLITE_OK) {
         return false;
     }
     sqlite3_bind_text(stmt, 1, category.c_str(), -1, SQLITE_STATIC);
     bool success = sqlite3_step(stmt) == SQLITE_DONE;
+    bool inserted = success && sqlite3_changes(mainDB) > 0;
     sqlite3_finalize(stmt);
+    if (inserted) categoriesCache.refresh([this] { return queryNames("Categories"); });
+    if (success) suggestIndex.recordUse(SuggestKind::Category, category, 0);
     return success;
 }
 
 std::vector<std::string> FinanceDB::getAllModeOfPayment() {
-    std::vector<std::string> modes;
-    if (!mainDB) return modes;
+    return modesCache.get()->names;
+}
 
-    std::string sql = "SELECT name FROM ModeOfPayment ORDER BY name;";
-    sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(mainDB, sql.c_str(), -1, &stmt, 0) == SQLITE_OK) {
-        while (sqlite3_step(stmt) == SQLITE_ROW) {
-            const char* name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
-            if (name) modes.push_back(name);
-        }
-    }
-    sqlite3_finalize(stmt);
-    return modes;
+std::shared_ptr<const RefDataSnapshot> FinanceDB::getModeOfPaymentSnapshot() const {
+    return modesCache.get();
 }
 
 bool FinanceDB::addModeOfPayment(const std::string& modeOfPayment) {
@@ -686,11 +2013,14 @@ bool FinanceDB::addModeOfPayment(const std::string& modeOfPayment) {
 
     std::string sql = "INSERT OR IGNORE INTO ModeOfPayment (name) VALUES (?);";
     sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(mainDB, sql.c_str(), -1, &stmt, 0) != SQLITE_OK) {
+    if (prepare(mainDB, sql, &stmt) != SQLITE_OK) {
         return false;
     }
     sqlite3_bind_text(stmt, 1, modeOfPayment.c_str(), -1, SQLITE_STATIC);
     bool success = sqlite3_step(stmt) == SQLITE_DONE;
+    bool inserted = success && sqlite3_changes(mainDB) > 0;
     sqlite3_finalize(stmt);
+    if (inserted) modesCache.refresh([this] { return queryNames("ModeOfPayment"); });
+    if (success) suggestIndex.recordUse(SuggestKind::ModeOfPayment, modeOfPayment, 0);
     return success;
 }
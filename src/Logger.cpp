@@ -0,0 +1,179 @@
+#include "Logger.h"
+#include <cstdio>
+#include <ctime>
+
+static const char* levelName(LogLevel level) {
+    switch (level) {
+    case LogLevel::Debug: return "DEBUG";
+    case LogLevel::Info: return "INFO ";
+    case LogLevel::Warn: return "WARN ";
+    default: return "ERROR";
+    }
+}
+
+// --- Logger ---
+
+Logger::Logger() : ring(new Slot[CAPACITY]) {
+    for (size_t i = 0; i < CAPACITY; ++i) ring[i].sequence.store(i, std::memory_order_relaxed);
+    worker = std::thread([this] { run(); });
+}
+
+Logger::~Logger() {
+    stopping = true;
+    wake.notify_one();
+    if (worker.joinable()) worker.join();
+}
+
+Logger& Logger::instance() {
+    static Logger logger;
+    return logger;
+}
+
+// Bounded MPSC ring (Vyukov): a slot is free for the producer whose position
+// matches its sequence, and readable by the consumer once the producer has
+// bumped the sequence to position + 1
+bool Logger::push(LogLevel level, std::string&& text) {
+    size_t pos = enqueuePos.load(std::memory_order_relaxed);
+    Slot* slot;
+    for (;;) {
+        slot = &ring[pos & (CAPACITY - 1)];
+        size_t seq = slot->sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            droppedCount.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+    slot->level = level;
+    slot->time = std::chrono::system_clock::now();
+    slot->text = std::move(text);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    if (level >= LogLevel::Warn) wake.notify_one();
+    return true;
+}
+
+// Writes out everything queued so far; returns the number of records written
+size_t Logger::drain() {
+    std::string out, err;
+    size_t count = 0;
+    for (;;) {
+        Slot& slot = ring[dequeuePos & (CAPACITY - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != dequeuePos + 1) break;
+
+        std::time_t seconds = std::chrono::system_clock::to_time_t(slot.time);
+        long millis = static_cast<long>(std::chrono::duration_cast<std::chrono::milliseconds>(slot.time.time_since_epoch()).count() % 1000);
+        std::tm tm_local;
+        localtime_r(&seconds, &tm_local);
+        char stamp[40];
+        size_t n = std::strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &tm_local);
+        std::snprintf(stamp + n, sizeof(stamp) - n, ".%03ld ", millis);
+
+        std::string& target = slot.level >= LogLevel::Warn ? err : out;
+        target += stamp;
+        target += levelName(slot.level);
+        target += ' ';
+        target += slot.text;
+        target += '\n';
+        std::string().swap(slot.text);
+
+        slot.sequence.store(dequeuePos + CAPACITY, std::memory_order_release);
+        dequeuePos++;
+        count++;
+    }
+
+    uint64_t dropped = droppedCount.load(std::memory_order_relaxed);
+    if (dropped != droppedReported) {
+        err += "WARN  msg=\"log ring full, records dropped\" dropped=" + std::to_string(dropped - droppedReported) + "\n";
+        droppedReported = dropped;
+    }
+    if (!out.empty()) {
+        std::fwrite(out.data(), 1, out.size(), stdout);
+        std::fflush(stdout);
+    }
+    if (!err.empty()) {
+        std::fwrite(err.data(), 1, err.size(), stderr);
+        std::fflush(stderr);
+    }
+    return count;
+}
+
+void Logger::run() {
+    while (!stopping) {
+        if (drain() == 0) {
+            // Warn/Error records wake us early; everything else waits for the tick
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wake.wait_for(lock, std::chrono::milliseconds(20));
+        }
+    }
+    drain();
+}
+
+// --- LogRecord ---
+
+LogRecord::LogRecord(LogLevel level, const std::string& message)
+    : level(level), active(Logger::instance().enabled(level)) {
+    if (!active) return;
+    text.reserve(96);
+    text += "msg=";
+    appendValue(message);
+}
+
+LogRecord::~LogRecord() {
+    if (active) Logger::instance().push(level, std::move(text));
+}
+
+// Values with spaces, quotes or '=' are quoted so lines stay machine-parsable
+void LogRecord::appendValue(const std::string& value) {
+    bool quote = value.empty() || value.find_first_of(" \"=\t\n") != std::string::npos;
+    if (!quote) {
+        text += value;
+        return;
+    }
+    text += '"';
+    for (char c : value) {
+        if (c == '"' || c == '\\') text += '\\';
+        if (c == '\n') {
+            text += "\\n";
+            continue;
+        }
+        text += c;
+    }
+    text += '"';
+}
+
+LogRecord& LogRecord::field(const char* key, const std::string& value) {
+    if (!active) return *this;
+    text += ' ';
+    text += key;
+    text += '=';
+    appendValue(value);
+    return *this;
+}
+
+LogRecord& LogRecord::field(const char* key, const char* value) {
+    return field(key, std::string(value ? value : ""));
+}
+
+LogRecord& LogRecord::field(const char* key, long long value) {
+    if (!active) return *this;
+    text += ' ';
+    text += key;
+    text += '=';
+    text += std::to_string(value);
+    return *this;
+}
+
+LogRecord& LogRecord::field(const char* key, double value) {
+    if (!active) return *this;
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.3f", value);
+    text += ' ';
+    text += key;
+    text += '=';
+    text += buf;
+    return *this;
+}
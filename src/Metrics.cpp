@@ -0,0 +1,202 @@
+#include "Metrics.h"
+#include <atomic>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+const double Metrics::BUCKET_BOUNDS[Metrics::NUM_BUCKETS - 1] = {
+    0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0};
+
+// Per series: NUM_BUCKETS bucket counts, then the observation count and the
+// sum in nanoseconds. Counters only use slot 0.
+static const size_t SLOTS = Metrics::NUM_BUCKETS + 2;
+
+struct MetricsShard {
+    std::atomic<uint64_t> slots[Metrics::MAX_SERIES * SLOTS];
+};
+
+struct MetricSeriesInfo {
+    MetricType type;
+    std::string name;
+    std::string labels;
+};
+
+struct MetricGaugeInfo {
+    std::string name;
+    std::string help;
+    std::function<double()> sample;
+    bool counter;
+};
+
+struct MetricsRegistry {
+    std::mutex mutex;
+    std::unordered_map<std::string, int> ids;
+    std::vector<MetricSeriesInfo> series;
+    std::map<std::string, std::string> help;
+    std::vector<MetricGaugeInfo> gauges;
+    std::vector<std::unique_ptr<MetricsShard>> shards;
+};
+
+static MetricsRegistry& registry() {
+    static MetricsRegistry* r = new MetricsRegistry(); // never destroyed: threads may record during exit
+    return *r;
+}
+
+static MetricsShard& localShard() {
+    thread_local MetricsShard* shard = [] {
+        auto owned = std::unique_ptr<MetricsShard>(new MetricsShard());
+        MetricsShard* raw = owned.get();
+        MetricsRegistry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.shards.push_back(std::move(owned));
+        return raw;
+    }();
+    return *shard;
+}
+
+// Only the owning thread writes to a shard, so a plain read-modify-write is
+// enough; the atomics just keep concurrent scrapes well defined
+static inline void bump(std::atomic<uint64_t>& slot, uint64_t n) {
+    slot.store(slot.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+int Metrics::series(MetricType type, const std::string& name, const std::string& labels) {
+    std::string key = name + "{" + labels + "}";
+    thread_local std::unordered_map<std::string, int> cache;
+    auto cached = cache.find(key);
+    if (cached != cache.end()) return cached->second;
+
+    MetricsRegistry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    auto it = r.ids.find(key);
+    int id;
+    if (it != r.ids.end()) {
+        id = it->second;
+    } else {
+        if (r.series.size() >= MAX_SERIES) return -1;
+        id = static_cast<int>(r.series.size());
+        r.series.push_back({type, name, labels});
+        r.ids[key] = id;
+    }
+    cache[key] = id;
+    return id;
+}
+
+void Metrics::describe(const std::string& name, const std::string& help) {
+    MetricsRegistry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.help[name] = help;
+}
+
+void Metrics::add(int id, uint64_t n) {
+    if (id < 0) return;
+    bump(localShard().slots[id * SLOTS], n);
+}
+
+void Metrics::observe(int id, double seconds) {
+    if (id < 0) return;
+    size_t bucket = 0;
+    while (bucket < NUM_BUCKETS - 1 && seconds > BUCKET_BOUNDS[bucket]) bucket++;
+    std::atomic<uint64_t>* slots = localShard().slots + id * SLOTS;
+    bump(slots[bucket], 1);
+    bump(slots[NUM_BUCKETS], 1);
+    bump(slots[NUM_BUCKETS + 1], static_cast<uint64_t>(seconds * 1e9));
+}
+
+void Metrics::gauge(const std::string& name, const std::string& help, std::function<double()> sample) {
+    MetricsRegistry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.gauges.push_back({name, help, std::move(sample), false});
+}
+
+void Metrics::sampledCounter(const std::string& name, const std::string& help, std::function<double()> sample) {
+    MetricsRegistry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.gauges.push_back({name, help, std::move(sample), true});
+}
+
+std::string Metrics::label(const std::string& value) {
+    std::string out;
+    out.reserve(value.size());
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            out += '\\';
+            out += c;
+        } else if (c == '\n') {
+            out += "\\n";
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+static std::string formatNumber(double value) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.9g", value);
+    return buf;
+}
+
+static std::string withLabels(const std::string& labels, const std::string& extra) {
+    if (labels.empty() && extra.empty()) return "";
+    if (labels.empty()) return "{" + extra + "}";
+    if (extra.empty()) return "{" + labels + "}";
+    return "{" + labels + "," + extra + "}";
+}
+
+std::string Metrics::render() {
+    MetricsRegistry& r = registry();
+    std::vector<MetricSeriesInfo> series;
+    std::map<std::string, std::string> help;
+    std::vector<MetricGaugeInfo> gauges;
+    std::vector<uint64_t> totals;
+    {
+        std::lock_guard<std::mutex> lock(r.mutex);
+        series = r.series;
+        help = r.help;
+        gauges = r.gauges;
+        totals.assign(series.size() * SLOTS, 0);
+        for (const auto& shard : r.shards) {
+            for (size_t i = 0; i < totals.size(); ++i) {
+                totals[i] += shard->slots[i].load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Group series by metric name so each family gets one HELP/TYPE header
+    std::map<std::string, std::vector<size_t>> families;
+    for (size_t i = 0; i < series.size(); ++i) families[series[i].name].push_back(i);
+
+    std::string out;
+    for (const auto& family : families) {
+        const MetricSeriesInfo& first = series[family.second.front()];
+        auto h = help.find(family.first);
+        if (h != help.end()) out += "# HELP " + family.first + " " + h->second + "\n";
+        out += "# TYPE " + family.first + (first.type == MetricType::Histogram ? " histogram\n" : " counter\n");
+        for (size_t idx : family.second) {
+            const MetricSeriesInfo& s = series[idx];
+            const uint64_t* slots = totals.data() + idx * SLOTS;
+            if (s.type != MetricType::Histogram) {
+                out += s.name + withLabels(s.labels, "") + " " + std::to_string(slots[0]) + "\n";
+                continue;
+            }
+            uint64_t cumulative = 0;
+            for (size_t b = 0; b < NUM_BUCKETS; ++b) {
+                cumulative += slots[b];
+                std::string le = b < NUM_BUCKETS - 1 ? formatNumber(BUCKET_BOUNDS[b]) : "+Inf";
+                out += s.name + "_bucket" + withLabels(s.labels, "le=\"" + le + "\"") + " " + std::to_string(cumulative) + "\n";
+            }
+            out += s.name + "_sum" + withLabels(s.labels, "") + " " + formatNumber(slots[NUM_BUCKETS + 1] / 1e9) + "\n";
+            out += s.name + "_count" + withLabels(s.labels, "") + " " + std::to_string(slots[NUM_BUCKETS]) + "\n";
+        }
+    }
+    for (const auto& g : gauges) {
+        out += "# HELP " + g.name + " " + g.help + "\n";
+        out += "# TYPE " + g.name + (g.counter ? " counter\n" : " gauge\n");
+        out += g.name + " " + formatNumber(g.sample()) + "\n";
+    }
+    return out;
+}
@@ -0,0 +1,122 @@
+#include "PriceRanks.h"
+
+void PriceRanks::pull(int32_t node) {
+    Node& n = nodes[node];
+    n.subtree = n.count + subtree(n.left) + subtree(n.right);
+}
+
+// xorshift32; the treap only needs priorities that don't follow the prices
+uint32_t PriceRanks::nextPriority() {
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+void PriceRanks::split(int32_t node, double price, bool inclusive, int32_t& left, int32_t& right) {
+    if (node < 0) {
+        left = right = -1;
+        return;
+    }
+    bool goesLeft = inclusive ? nodes[node].price <= price : nodes[node].price < price;
+    if (goesLeft) {
+        int32_t rest;
+        split(nodes[node].right, price, inclusive, rest, right);
+        nodes[node].right = rest;
+        left = node;
+    } else {
+        int32_t rest;
+        split(nodes[node].left, price, inclusive, left, rest);
+        nodes[node].left = rest;
+        right = node;
+    }
+    pull(node);
+}
+
+int32_t PriceRanks::merge(int32_t left, int32_t right) {
+    if (left < 0) return right;
+    if (right < 0) return left;
+    if (nodes[left].priority > nodes[right].priority) {
+        nodes[left].right = merge(nodes[left].right, right);
+        pull(left);
+        return left;
+    }
+    nodes[right].left = merge(left, nodes[right].left);
+    pull(right);
+    return right;
+}
+
+void PriceRanks::add(double price) {
+    // A price already present only gains a copy along its path
+    int32_t node = root;
+    while (node >= 0 && nodes[node].price != price) node = price < nodes[node].price ? nodes[node].left : nodes[node].right;
+    if (node >= 0) {
+        for (int32_t n = root;; n = price < nodes[n].price ? nodes[n].left : nodes[n].right) {
+            nodes[n].subtree++;
+            if (n == node) break;
+        }
+        nodes[node].count++;
+        return;
+    }
+
+    int32_t slot;
+    if (!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    } else {
+        slot = static_cast<int32_t>(nodes.size());
+        nodes.emplace_back();
+    }
+    nodes[slot] = Node{price, 1, 1, nextPriority()};
+    int32_t less, rest;
+    split(root, price, false, less, rest);
+    root = merge(merge(less, slot), rest);
+}
+
+bool PriceRanks::erase(double price) {
+    int32_t node = root;
+    while (node >= 0 && nodes[node].price != price) node = price < nodes[node].price ? nodes[node].left : nodes[node].right;
+    if (node < 0) return false;
+    if (nodes[node].count > 1) {
+        for (int32_t n = root;; n = price < nodes[n].price ? nodes[n].left : nodes[n].right) {
+            nodes[n].subtree--;
+            if (n == node) break;
+        }
+        nodes[node].count--;
+        return true;
+    }
+
+    int32_t less, rest, equal, greater;
+    split(root, price, false, less, rest);
+    split(rest, price, true, equal, greater);
+    root = merge(less, greater);
+    freeSlots.push_back(equal);
+    return true;
+}
+
+void PriceRanks::clear() {
+    nodes.clear();
+    freeSlots.clear();
+    root = -1;
+}
+
+double PriceRanks::select(size_t rank) const {
+    int32_t node = root;
+    while (node >= 0) {
+        const Node& n = nodes[node];
+        size_t before = subtree(n.left);
+        if (rank < before) {
+            node = n.left;
+        } else if (rank < before + n.count) {
+            return n.price;
+        } else {
+            rank -= before + n.count;
+            node = n.right;
+        }
+    }
+    return 0.0;
+}
+
+size_t PriceRanks::memoryBytes() const {
+    return nodes.capacity() * sizeof(Node) + freeSlots.capacity() * sizeof(int32_t);
+}
@@ -0,0 +1,85 @@
+#include "QuantileSketch.h"
+#include <algorithm>
+
+void QuantileSketch::add(double value) {
+    buffer.push_back(value);
+    totalWeight += 1.0;
+    if (buffer.size() >= BUFFER_SIZE) compress();
+}
+
+void QuantileSketch::merge(const QuantileSketch& other) {
+    std::vector<Centroid> incoming(other.centroids);
+    for (double value : other.buffer) incoming.push_back({value, 1.0});
+    totalWeight += other.totalWeight;
+    fold(incoming);
+}
+
+void QuantileSketch::compress() {
+    if (buffer.empty()) return;
+    std::vector<Centroid> incoming;
+    fold(incoming);
+}
+
+// Merges `incoming` and the buffer with the current centroids in one sorted
+// pass. A centroid may absorb its neighbour while its weight stays under
+// 4·N·q·(1-q)/δ, the t-digest k1 bound, so centroids near q = 0 and q = 1
+// stay small.
+void QuantileSketch::fold(std::vector<Centroid>& incoming) {
+    for (double value : buffer) incoming.push_back({value, 1.0});
+    buffer.clear();
+    incoming.insert(incoming.end(), centroids.begin(), centroids.end());
+    std::sort(incoming.begin(), incoming.end(), [](const Centroid& a, const Centroid& b) { return a.mean < b.mean; });
+
+    centroids.clear();
+    double before = 0.0; // weight of the centroids already emitted
+    for (const Centroid& c : incoming) {
+        if (!centroids.empty()) {
+            Centroid& last = centroids.back();
+            double merged = last.weight + c.weight;
+            double q = (before + merged / 2.0) / totalWeight;
+            if (merged <= 4.0 * totalWeight * q * (1.0 - q) / COMPRESSION) {
+                last.mean += (c.mean - last.mean) * c.weight / merged;
+                last.weight = merged;
+                continue;
+            }
+            before += last.weight;
+        }
+        centroids.push_back(c);
+    }
+}
+
+void QuantileSketch::clear() {
+    centroids.clear();
+    buffer.clear();
+    totalWeight = 0.0;
+}
+
+double QuantileSketch::quantile(double q, double min, double max) const {
+    if (centroids.empty()) return 0.0;
+    if (centroids.size() == 1) return centroids[0].mean;
+    double target = std::min(std::max(q, 0.0), 1.0) * totalWeight;
+
+    // Each centroid's mass is taken to sit at its centre; interpolate between
+    // neighbouring centres, and between the extremes and the outer centres
+    double cumulative = 0.0;
+    double prevCentre = 0.0;
+    double prevMean = min;
+    for (const Centroid& c : centroids) {
+        double centre = cumulative + c.weight / 2.0;
+        if (target <= centre) {
+            double span = centre - prevCentre;
+            double t = span > 0 ? (target - prevCentre) / span : 0.0;
+            return std::min(std::max(prevMean + t * (c.mean - prevMean), min), max);
+        }
+        prevCentre = centre;
+        prevMean = c.mean;
+        cumulative += c.weight;
+    }
+    double span = totalWeight - prevCentre;
+    double t = span > 0 ? (target - prevCentre) / span : 1.0;
+    return std::min(std::max(prevMean + t * (max - prevMean), min), max);
+}
+
+size_t QuantileSketch::memoryBytes() const {
+    return centroids.capacity() * sizeof(Centroid) + buffer.capacity() * sizeof(double);
+}
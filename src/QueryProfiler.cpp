@@ -0,0 +1,187 @@
+#include "QueryProfiler.h"
+#include "helper.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+QueryProfiler::QueryProfiler(double thresholdMs, const std::string& logPath, ExplainFn explainFn, size_t maxLogBytes,
+                             int logFiles, size_t maxSlowEntries)
+    : thresholdSeconds(thresholdMs / 1000.0), logPath(logPath), maxLogBytes(maxLogBytes), logFiles(logFiles),
+      maxSlowEntries(maxSlowEntries), explainFn(std::move(explainFn)) {
+    if (!logPath.empty()) log.open(logPath, std::ios::app);
+    worker = std::thread([this] { run(); });
+}
+
+QueryProfiler::~QueryProfiler() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    if (worker.joinable()) worker.join();
+}
+
+std::string QueryProfiler::normalize(const char* sql) {
+    std::string out;
+    if (!sql) return out;
+    for (const char* p = sql; *p;) {
+        char c = *p;
+        if (c == '\'') {
+            // string literal; '' is an escaped quote
+            ++p;
+            while (*p && !(*p == '\'' && p[1] != '\'')) p += (*p == '\'') ? 2 : 1;
+            if (*p) ++p;
+            out += '?';
+        } else if (std::isdigit(static_cast<unsigned char>(c)) &&
+                   (out.empty() || !(std::isalnum(static_cast<unsigned char>(out.back())) || out.back() == '_'))) {
+            while (std::isalnum(static_cast<unsigned char>(*p)) || *p == '.') ++p;
+            out += '?';
+        } else if (std::strncmp(p, "expenses_", 9) == 0 && std::isdigit(static_cast<unsigned char>(p[9]))) {
+            p += 9;
+            while (std::isdigit(static_cast<unsigned char>(*p)) || *p == '_') ++p;
+            out += "expenses_MM_YYYY";
+        } else if (std::isspace(static_cast<unsigned char>(c))) {
+            while (std::isspace(static_cast<unsigned char>(*p))) ++p;
+            if (!out.empty()) out += ' ';
+        } else {
+            out += c;
+            ++p;
+        }
+    }
+    while (!out.empty() && out.back() == ' ') out.pop_back();
+    return out;
+}
+
+std::string QueryProfiler::explain(sqlite3* db, const char* sql) {
+    std::string plan;
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, (std::string("EXPLAIN QUERY PLAN ") + sql).c_str(), -1, &stmt, 0) != SQLITE_OK) {
+        return plan;
+    }
+    std::unordered_map<int, int> depth;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        int id = sqlite3_column_int(stmt, 0);
+        int parent = sqlite3_column_int(stmt, 1);
+        const unsigned char* detail = sqlite3_column_text(stmt, 3);
+        depth[id] = parent == 0 ? 0 : depth[parent] + 1;
+        if (!plan.empty()) plan += "\n";
+        plan += std::string(depth[id] * 2, ' ') + (detail ? reinterpret_cast<const char*>(detail) : "");
+    }
+    sqlite3_finalize(stmt);
+    return plan;
+}
+
+void QueryProfiler::record(const char* dbName, sqlite3_stmt* stmt, double seconds, uint64_t steps) {
+    std::string key = normalize(sqlite3_sql(stmt));
+    if (key.empty()) return;
+
+    SlowQuery entry;
+    bool isSlow = seconds >= thresholdSeconds;
+    if (isSlow) {
+        char* expanded = sqlite3_expanded_sql(stmt);
+        entry.sql = expanded ? expanded : sqlite3_sql(stmt);
+        sqlite3_free(expanded);
+        entry.templateSql = sqlite3_sql(stmt);
+        entry.key = key;
+        entry.db = dbName;
+        entry.seconds = seconds;
+        entry.steps = steps;
+        std::time_t now = std::time(nullptr);
+        std::tm tm_local;
+        localtime_r(&now, &tm_local);
+        std::stringstream ss;
+        ss << std::put_time(&tm_local, "%Y-%m-%d %H:%M:%S");
+        entry.time = ss.str();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    TemplateStats& stats = templates[key];
+    stats.db = dbName;
+    stats.count++;
+    stats.totalSeconds += seconds;
+    stats.maxSeconds = std::max(stats.maxSeconds, seconds);
+    stats.steps += steps;
+    if (!isSlow || pending.size() >= maxSlowEntries) return;
+    pending.push_back(std::move(entry));
+    wake.notify_one();
+}
+
+// Explains queued slow runs one at a time, then logs and lists them
+void QueryProfiler::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wake.wait(lock, [this] { return stopping || !pending.empty(); });
+        if (stopping) return;
+        SlowQuery entry = std::move(pending.front());
+        pending.pop_front();
+        lock.unlock();
+        if (explainFn) entry.plan = explainFn(entry.db, entry.templateSql);
+        lock.lock();
+        auto stats = templates.find(entry.key);
+        if (stats != templates.end() && stats->second.plan.empty()) stats->second.plan = entry.plan;
+        writeLog(entry);
+        slow.push_front(std::move(entry));
+        if (slow.size() > maxSlowEntries) slow.pop_back();
+    }
+}
+
+// Caller holds the mutex
+void QueryProfiler::writeLog(const SlowQuery& entry) {
+    if (!log.is_open()) return;
+    log << entry.time << " db=" << entry.db << " ms=" << std::fixed << std::setprecision(3) << entry.seconds * 1000.0
+        << " steps=" << entry.steps << " sql=" << entry.sql << "\n";
+    std::istringstream plan(entry.plan);
+    for (std::string line; std::getline(plan, line);) log << "    " << line << "\n";
+    log.flush();
+
+    if (static_cast<size_t>(log.tellp()) < maxLogBytes) return;
+    log.close();
+    std::remove((logPath + "." + std::to_string(logFiles)).c_str());
+    for (int i = logFiles - 1; i >= 1; --i) {
+        std::rename((logPath + "." + std::to_string(i)).c_str(), (logPath + "." + std::to_string(i + 1)).c_str());
+    }
+    std::rename(logPath.c_str(), (logPath + ".1").c_str());
+    log.open(logPath, std::ios::app);
+}
+
+std::string QueryProfiler::toJson() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<std::pair<std::string, const TemplateStats*>> sorted;
+    for (const auto& t : templates) sorted.push_back({t.first, &t.second});
+    std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.second->totalSeconds > b.second->totalSeconds; });
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3);
+    out << "{\"threshold_ms\": " << thresholdSeconds * 1000.0 << ", \"statements\": [";
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        const TemplateStats& s = *sorted[i].second;
+        if (i > 0) out << ", ";
+        out << "{\"sql\": \"" << jsonEscape(sorted[i].first) << "\", \"db\": \"" << s.db << "\", \"count\": " << s.count
+            << ", \"total_ms\": " << s.totalSeconds * 1000.0 << ", \"avg_ms\": " << s.totalSeconds * 1000.0 / s.count
+            << ", \"max_ms\": " << s.maxSeconds * 1000.0 << ", \"steps\": " << s.steps << ", \"plan\": \""
+            << jsonEscape(s.plan) << "\"}";
+    }
+    out << "], \"slow\": [";
+    for (size_t i = 0; i < slow.size(); ++i) {
+        const SlowQuery& q = slow[i];
+        if (i > 0) out << ", ";
+        out << "{\"time\": \"" << q.time << "\", \"db\": \"" << q.db << "\", \"ms\": " << q.seconds * 1000.0
+            << ", \"steps\": " << q.steps << ", \"sql\": \"" << jsonEscape(q.sql) << "\", \"plan\": \"" << jsonEscape(q.plan)
+            << "\"}";
+    }
+    out << "]}";
+    return out.str();
+}
+
+void QueryProfiler::reset() {
+    std::lock_guard<std::mutex> lock(mutex);
+    templates.clear();
+    slow.clear();
+    pending.clear();
+}
@@ -0,0 +1,66 @@
+#include "ReadPool.h"
+#include "Logger.h"
+
+ReadPool::Lease::~Lease() {
+    if (pool) pool->release(connection);
+}
+
+ReadPool::~ReadPool() {
+    close();
+}
+
+void ReadPool::close() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (sqlite3* connection : connections) sqlite3_close(connection);
+    connections.clear();
+    idle.clear();
+}
+
+bool ReadPool::open(const std::string& path, size_t size, const std::function<bool(sqlite3*)>& setup) {
+    std::vector<sqlite3*> opened;
+    for (size_t i = 0; i < size; ++i) {
+        sqlite3* connection = nullptr;
+        // Each connection is used by one thread at a time, so SQLite's own
+        // per-connection mutex is not needed
+        bool ok = sqlite3_open_v2(path.c_str(), &connection, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr) == SQLITE_OK &&
+                  setup(connection);
+        if (!ok) {
+            logError("Failed to open read connection").field("path", path).field("error", sqlite3_errmsg(connection));
+            sqlite3_close(connection);
+            for (sqlite3* c : opened) sqlite3_close(c);
+            return false;
+        }
+        opened.push_back(connection);
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    connections = opened;
+    idle = std::move(opened);
+    return true;
+}
+
+ReadPool::Lease ReadPool::lease(sqlite3* fallback) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (connections.empty()) return Lease(nullptr, fallback);
+    returned.wait(lock, [this] { return !idle.empty(); });
+    sqlite3* connection = idle.back();
+    idle.pop_back();
+    return Lease(this, connection);
+}
+
+void ReadPool::release(sqlite3* connection) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        idle.push_back(connection);
+    }
+    returned.notify_one();
+}
+
+size_t ReadPool::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return connections.size();
+}
+
+size_t ReadPool::busy() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return connections.size() - idle.size();
+}
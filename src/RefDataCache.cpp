@@ -0,0 +1,41 @@
+#include "RefDataCache.h"
+#include "helper.h"
+#include <atomic>
+
+const std::string& RefDataSnapshot::name(int id) const {
+    static const std::string none;
+    auto it = nameById.find(id);
+    return it == nameById.end() ? none : it->second;
+}
+
+int RefDataSnapshot::id(const std::string& name) const {
+    auto it = idByName.find(name);
+    return it == idByName.end() ? 0 : it->second;
+}
+
+static std::shared_ptr<const RefDataSnapshot> buildSnapshot(const std::vector<std::pair<int, std::string>>& rows) {
+    auto snapshot = std::make_shared<RefDataSnapshot>();
+    snapshot->json = "[";
+    for (size_t i = 0; i < rows.size(); ++i) {
+        if (i > 0) snapshot->json += ",";
+        snapshot->json += "\"" + jsonEscape(rows[i].second) + "\"";
+        snapshot->names.push_back(rows[i].second);
+        snapshot->nameById[rows[i].first] = rows[i].second;
+        snapshot->idByName[rows[i].second] = rows[i].first;
+    }
+    snapshot->json += "]";
+    snapshot->etag = makeETag(snapshot->json);
+    snapshot->encodedJson.reset(new PrecompressedBody(snapshot->json, "application/json"));
+    return snapshot;
+}
+
+RefDataCache::RefDataCache() : current(buildSnapshot({})) {}
+
+std::shared_ptr<const RefDataSnapshot> RefDataCache::get() const {
+    return std::atomic_load(&current);
+}
+
+void RefDataCache::refresh(const std::function<std::vector<std::pair<int, std::string>>()>& loader) {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    std::atomic_store(&current, buildSnapshot(loader()));
+}
@@ -0,0 +1,88 @@
+#include "SpendWindows.h"
+#include <algorithm>
+#include <ctime>
+
+const int SpendWindows::WINDOWS[WINDOW_COUNT] = {7, 30, 90};
+
+// Howard Hinnant's days_from_civil
+int SpendWindows::dayNumber(int yyyymmdd) {
+    int y = yyyymmdd / 10000;
+    unsigned m = static_cast<unsigned>(yyyymmdd / 100 % 100);
+    unsigned d = static_cast<unsigned>(yyyymmdd % 100);
+    y -= m <= 2;
+    int era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = static_cast<unsigned>(y - era * 400);
+    unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int>(doe) - 719468;
+}
+
+int SpendWindows::currentDay() {
+    std::time_t now = std::time(nullptr);
+    std::tm tm_local;
+    localtime_r(&now, &tm_local);
+    return dayNumber((tm_local.tm_year + 1900) * 10000 + (tm_local.tm_mon + 1) * 100 + tm_local.tm_mday);
+}
+
+void SpendWindows::advanceTo(int day) {
+    if (day <= today) return;
+    if (today == 0 || day - today >= MAX_DAYS) {
+        ring.fill(0.0);
+        sums.fill(0.0);
+        today = day - MAX_DAYS; // nothing to carry over; only pull in future days below
+        future.erase(future.begin(), future.upper_bound(today));
+    }
+    while (today < day) {
+        ++today;
+        // Each window loses the day that just slid out of it; for the widest
+        // window that is the slot about to be reused
+        for (int i = 0; i < WINDOW_COUNT; ++i) {
+            sums[i] -= ring[(today - WINDOWS[i]) % MAX_DAYS];
+        }
+        double& slot = ring[today % MAX_DAYS];
+        slot = 0.0;
+        auto it = future.find(today);
+        if (it != future.end()) {
+            slot = it->second;
+            for (double& sum : sums) sum += it->second;
+            future.erase(it);
+        }
+    }
+}
+
+void SpendWindows::add(int yyyymmdd, double amount) {
+    if (yyyymmdd == 0) return;
+    int day = dayNumber(yyyymmdd);
+    std::lock_guard<std::mutex> lock(mutex);
+    advanceTo(currentDay());
+    if (day > today) {
+        future[day] += amount;
+        return;
+    }
+    int age = today - day;
+    if (age >= MAX_DAYS) return;
+    ring[day % MAX_DAYS] += amount;
+    for (int i = 0; i < WINDOW_COUNT; ++i) {
+        if (age < WINDOWS[i]) sums[i] += amount;
+    }
+}
+
+void SpendWindows::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    ring.fill(0.0);
+    sums.fill(0.0);
+    future.clear();
+    today = 0;
+}
+
+double SpendWindows::total(int days) {
+    days = std::min(std::max(days, 1), MAX_DAYS);
+    std::lock_guard<std::mutex> lock(mutex);
+    advanceTo(currentDay());
+    for (int i = 0; i < WINDOW_COUNT; ++i) {
+        if (WINDOWS[i] == days) return sums[i];
+    }
+    double sum = 0.0;
+    for (int age = 0; age < days; ++age) sum += ring[(today - age) % MAX_DAYS];
+    return sum;
+}
@@ -0,0 +1,89 @@
+#include "StaticAssets.h"
+#include "Logger.h"
+#include "helper.h"
+#include <dirent.h>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+
+std::string contentTypeFor(const std::string& fileName) {
+    static const std::unordered_map<std::string, std::string> types = {
+        {"html", "text/html; charset=utf-8"},
+        {"css", "text/css; charset=utf-8"},
+        {"js", "application/javascript; charset=utf-8"},
+        {"json", "application/json"},
+        {"svg", "image/svg+xml"},
+        {"png", "image/png"},
+        {"jpg", "image/jpeg"},
+        {"ico", "image/x-icon"},
+        {"txt", "text/plain; charset=utf-8"},
+    };
+    size_t dot = fileName.rfind('.');
+    if (dot != std::string::npos) {
+        auto it = types.find(fileName.substr(dot + 1));
+        if (it != types.end()) return it->second;
+    }
+    return "application/octet-stream";
+}
+
+size_t StaticAssets::load(const std::string& dir) {
+    DIR* handle = opendir(dir.c_str());
+    if (!handle) {
+        logError("Cannot open static asset directory").field("dir", dir);
+        return 0;
+    }
+    size_t count = 0;
+    size_t totalBytes = 0;
+    while (dirent* entry = readdir(handle)) {
+        std::string name = entry->d_name;
+        std::string file = dir + "/" + name;
+        struct stat st;
+        if (name[0] == '.' || stat(file.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) continue;
+
+        std::ifstream in(file, std::ios::binary);
+        std::stringstream contents;
+        contents << in.rdbuf();
+        if (!in) {
+            logWarn("Cannot read static asset").field("file", file);
+            continue;
+        }
+
+        auto asset = std::make_shared<StaticAsset>();
+        asset->contentType = contentTypeFor(name);
+        std::string body = contents.str();
+        asset->etag = makeETag(body);
+        asset->version = asset->etag.substr(1, asset->etag.size() - 2);
+        totalBytes += body.size();
+        asset->body.reset(new PrecompressedBody(std::move(body), asset->contentType));
+        // Compress now so no request ever pays for it
+        if (isCompressible(asset->contentType)) {
+            for (ContentEncoding encoding : {ContentEncoding::Deflate, ContentEncoding::Gzip, ContentEncoding::Zstd}) {
+                asset->body->get(encoding);
+            }
+        }
+        byPath["/" + name] = std::move(asset);
+        count++;
+    }
+    closedir(handle);
+    logInfo("Static assets loaded").field("dir", dir).field("files", count).field("bytes", totalBytes);
+    return count;
+}
+
+bool StaticAssets::alias(const std::string& path, const std::string& target) {
+    auto it = byPath.find(target);
+    if (it == byPath.end()) return false;
+    byPath[path] = it->second;
+    return true;
+}
+
+const StaticAsset* StaticAssets::find(const std::string& path) const {
+    auto it = byPath.find(path);
+    return it == byPath.end() ? nullptr : it->second.get();
+}
+
+std::vector<std::string> StaticAssets::paths() const {
+    std::vector<std::string> out;
+    out.reserve(byPath.size());
+    for (const auto& entry : byPath) out.push_back(entry.first);
+    return out;
+}
@@ -0,0 +1,107 @@
+#include "SuggestIndex.h"
+#include <algorithm>
+#include <cctype>
+#include <mutex>
+
+// Lowercase key used for case-insensitive prefix matching
+static std::string suggestKey(const std::string& str) {
+    std::string key(str);
+    std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return std::tolower(c); });
+    return key;
+}
+
+SuggestIndex::SuggestIndex(size_t maxEntriesPerKind)
+    : maxEntriesPerKind(maxEntriesPerKind) {}
+
+void SuggestIndex::upsert(std::vector<Entry>& list, const std::string& name, int weight, bool add) {
+    std::string key = suggestKey(name);
+    auto it = std::lower_bound(list.begin(), list.end(), key,
+                               [](const Entry& e, const std::string& k) { return e.key < k; });
+    if (it != list.end() && it->key == key) {
+        it->weight = add ? it->weight + weight : weight;
+        it->name = name;
+        return;
+    }
+
+    size_t pos = it - list.begin();
+    if (list.size() >= maxEntriesPerKind) {
+        // Full: the newcomer replaces the lightest entry. A use takes over its
+        // weight as well (space-saving), so a new name can always get in and
+        // stays if it keeps being used; an exact weight must outweigh it.
+        auto lightest = std::min_element(list.begin(), list.end(),
+                                         [](const Entry& a, const Entry& b) { return a.weight < b.weight; });
+        if (lightest == list.end() || weight <= 0) return;
+        if (add) {
+            weight += lightest->weight;
+        } else if (lightest->weight >= weight) {
+            return;
+        }
+        if (static_cast<size_t>(lightest - list.begin()) < pos) --pos;
+        list.erase(lightest);
+    }
+    list.insert(list.begin() + pos, Entry{key, name, weight});
+}
+
+void SuggestIndex::takeBack(std::vector<Entry>& list, const std::string& name, int uses, bool dropUnused) {
+    std::string key = suggestKey(name);
+    auto it = std::lower_bound(list.begin(), list.end(), key,
+                               [](const Entry& e, const std::string& k) { return e.key < k; });
+    if (it == list.end() || it->key != key) return;
+    it->weight = std::max(0, it->weight - uses);
+    if (it->weight == 0 && dropUnused) list.erase(it);
+}
+
+void SuggestIndex::recordUse(SuggestKind kind, const std::string& name, int delta) {
+    if (name.empty()) return;
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    std::vector<Entry>& list = entries[static_cast<int>(kind)];
+    // Items exist only through their uses; categories and modes of payment
+    // stay suggestable at weight 0 as long as they are defined
+    if (delta < 0) {
+        takeBack(list, name, -delta, kind == SuggestKind::Item);
+    } else {
+        upsert(list, name, delta, true);
+    }
+}
+
+void SuggestIndex::setWeight(SuggestKind kind, const std::string& name, int weight) {
+    if (name.empty()) return;
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    upsert(entries[static_cast<int>(kind)], name, weight, false);
+}
+
+void SuggestIndex::clear(SuggestKind kind) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    entries[static_cast<int>(kind)].clear();
+}
+
+std::vector<Suggestion> SuggestIndex::suggest(SuggestKind kind, const std::string& prefix, size_t limit) const {
+    std::vector<Suggestion> result;
+    if (limit == 0) return result;
+
+    std::string key = suggestKey(prefix);
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    const std::vector<Entry>& list = entries[static_cast<int>(kind)];
+
+    // All names sharing the prefix form one contiguous run in the sorted list
+    auto it = std::lower_bound(list.begin(), list.end(), key,
+                               [](const Entry& e, const std::string& k) { return e.key < k; });
+    auto heavier = [](const Entry* a, const Entry* b) { return a->weight > b->weight; };
+    std::vector<const Entry*> best; // kept sorted heaviest first, at most `limit` long
+    for (; it != list.end() && it->key.compare(0, key.size(), key) == 0; ++it) {
+        if (best.size() == limit && best.back()->weight >= it->weight) continue;
+        best.insert(std::upper_bound(best.begin(), best.end(), &*it, heavier), &*it);
+        if (best.size() > limit) best.pop_back();
+    }
+
+    result.reserve(best.size());
+    for (const Entry* e : best) {
+        result.push_back({e->name, e->weight});
+    }
+    return result;
+}
+
+size_t SuggestIndex::size(SuggestKind kind) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return entries[static_cast<int>(kind)].size();
+}
@@ -1,4 +1,6 @@
 #include "helper.h"
+#include <cstdint>
+#include <cstdio>
 #include <ctime>
 #include <iomanip>
 #include <sstream>
@@ -47,3 +49,62 @@ std::string refinedString(const std::string &str) {
   res[0] = toupper(res[0]);
   return res;
 }
+
+int parseExpenseDate(const std::string &dayMonthYear) {
+  int a = 0, b = 0, c = 0;
+  char s1 = 0, s2 = 0;
+  if (std::sscanf(dayMonthYear.c_str(), "%d%c%d%c%d", &a, &s1, &b, &s2, &c) != 5)
+    return 0;
+  if ((s1 != '_' && s1 != '-') || (s2 != '_' && s2 != '-'))
+    return 0;
+  int year = a > 31 ? a : c;
+  int month = b;
+  int day = a > 31 ? c : a;
+  if (month < 1 || month > 12 || day < 1 || day > 31 || year < 1000)
+    return 0;
+  return year * 10000 + month * 100 + day;
+}
+
+std::string jsonEscape(const std::string &str) {
+  std::string res;
+  res.reserve(str.size());
+  for (unsigned char c : str) {
+    switch (c) {
+    case '"':
+      res += "\\\"";
+      break;
+    case '\\':
+      res += "\\\\";
+      break;
+    case '\n':
+      res += "\\n";
+      break;
+    case '\r':
+      res += "\\r";
+      break;
+    case '\t':
+      res += "\\t";
+      break;
+    default:
+      if (c < 0x20) {
+        char buf[7];
+        std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+        res += buf;
+      } else {
+        res += static_cast<char>(c);
+      }
+    }
+  }
+  return res;
+}
+
+std::string makeETag(const std::string &body) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char c : body) {
+    hash ^= c;
+    hash *= 1099511628211ULL;
+  }
+  char buf[21];
+  std::snprintf(buf, sizeof(buf), "\"%016llx\"", static_cast<unsigned long long>(hash));
+  return buf;
+}
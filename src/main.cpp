@@ -1,21 +1,106 @@
+#include "Backup.h"
 #include "FinanceDB.h"
 #include "crow_all.h"
 #include "helper.h"
+#include "ChangeFeed.h"
+#include "Compression.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "StaticAssets.h"
 #include <sqlite3.h>
 #include <sodium.h>
 #include <sciplot/sciplot.hpp>
+#include <atomic>
 #include <chrono>
+#include <cstdlib>
 #include <ctime>
 #include <fstream>
+#include <future>
 #include <memory>
 #include <algorithm>
+#include <sstream>
 #include <string>
 #include <map>
 #include <mutex>
 #include <iostream>
+#include <thread>
 
 extern std::map<std::string, std::pair<int, time_t>> sessions;
 extern std::mutex sessions_mutex;
+extern StaticAssets frontend_assets;
+
+// Startup timing: everything is measured from static initialization, which
+// is as close to exec() as the process gets
+const std::chrono::steady_clock::time_point process_start = std::chrono::steady_clock::now();
+std::atomic<bool> first_request_served{false};
+
+long long ms_since_start() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - process_start).count();
+}
+
+// Route label for metrics: the template of the route that matched, so
+// /expenses/08_2025 and /expenses/09_2025 share a series and the number of
+// series is bounded by the route table. Anything no route matched (404s,
+// probes) shares a single label.
+std::string metrics_route(const crow::request& req) {
+    return req.route.empty() ? "<unmatched>" : req.route;
+}
+
+struct AuthMiddleware;
+
+// Records request count by status and latency per route, and writes one
+// access log line per request. Listed first in the app so its after_handle
+// runs last and covers the other middlewares too.
+struct MetricsMiddleware {
+    struct context {
+        std::chrono::steady_clock::time_point start;
+    };
+
+    void before_handle(crow::request& req, crow::response& res, context& ctx) {
+        ctx.start = std::chrono::steady_clock::now();
+    }
+
+    template <typename AllContext>
+    void after_handle(crow::request& req, crow::response& res, context& ctx, AllContext& all) {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - ctx.start).count();
+        std::string route = metrics_route(req);
+        std::string method = crow::method_name(req.method);
+        std::string labels = "method=\"" + method + "\",route=\"" + Metrics::label(route) + "\"";
+        Metrics::add(Metrics::series(MetricType::Counter, "http_requests_total", labels + ",status=\"" + std::to_string(res.code) + "\""));
+        Metrics::observe(Metrics::series(MetricType::Histogram, "http_request_duration_seconds", labels), seconds);
+        logInfo("request")
+            .field("method", method)
+            .field("route", route)
+            .field("status", res.code)
+            .field("user_id", all.template get<AuthMiddleware>().user_id)
+            .field("latency_ms", seconds * 1000.0);
+        if (!first_request_served.load(std::memory_order_relaxed) && !first_request_served.exchange(true)) {
+            logInfo("First request served").field("route", route).field("ms_since_start", ms_since_start());
+        }
+    }
+};
+
+// Compresses large text responses (JSON listings, SVG graphs) with the best
+// encoding the client accepts. Responses that already carry a
+// Content-Encoding, such as precompressed cached bodies, are left alone.
+struct CompressionMiddleware {
+    struct context {};
+
+    void before_handle(crow::request& req, crow::response& res, context& ctx) {}
+
+    void after_handle(crow::request& req, crow::response& res, context& ctx) {
+        if (res.body.size() < COMPRESSION_MIN_BYTES || !res.get_header_value("Content-Encoding").empty()) return;
+        std::string contentType = res.get_header_value("Content-Type");
+        if (!isCompressible(contentType)) return;
+        res.set_header("Vary", "Accept-Encoding");
+        ContentEncoding encoding = negotiateEncoding(req.get_header_value("Accept-Encoding"));
+        if (encoding == ContentEncoding::Identity) return;
+        std::string compressed;
+        if (!compressBody(res.body, encoding, compressionLevel(contentType, encoding), compressed) || compressed.size() >= res.body.size()) return;
+        res.body = std::move(compressed);
+        res.set_header("Content-Encoding", encodingName(encoding));
+    }
+};
 
 struct AuthMiddleware {
     struct context {
@@ -38,7 +123,11 @@ struct AuthMiddleware {
         return path == "/" || 
                path == "/register" || 
                path == "/login" || 
-               path == "/logout";
+               path == "/logout" ||
+               path == "/metrics" ||
+               path == "/healthz" ||
+               path == "/readyz" ||
+               frontend_assets.find(path) != nullptr;
     }
 
     void before_handle(crow::request& req, crow::response& res, context& ctx) {
@@ -79,9 +168,59 @@ struct AuthMiddleware {
     }
 };
 
+// Sends Crow's own log lines through the async logger
+struct CrowLogHandler : public crow::ILogHandler {
+    void log(const std::string& message, crow::LogLevel level) override {
+        switch (level) {
+        case crow::LogLevel::Debug: logDebug(message).field("source", "crow"); break;
+        case crow::LogLevel::Info: logInfo(message).field("source", "crow"); break;
+        case crow::LogLevel::Warning: logWarn(message).field("source", "crow"); break;
+        default: logError(message).field("source", "crow"); break;
+        }
+    }
+};
+CrowLogHandler crow_log_handler;
+
 sqlite3* auth_db;
 
 const int SESSION_EXPIRE_SECONDS = 3600;
+// Connection tuning. The frontend opens a handful of keep-alive connections
+// and fans ~10 requests over them on every page load, so idle connections are
+// kept a little longer than Crow's 5 s default and Nagle is disabled (without
+// TCP_NODELAY each response after the first on a connection waits ~40 ms for
+// the client's delayed ACK).
+const int KEEP_ALIVE_TIMEOUT_SECONDS = 15;
+const int LISTEN_BACKLOG = 1024;
+// Open sockets, /changes/live WebSockets included
+const size_t MAX_CONNECTIONS = 2048;
+const size_t MAX_REQUESTS_PER_CONNECTION = 10000;
+// Largest k accepted by /top/<k>
+const int MAX_TOP_K = 100;
+// Page size of /changes: the default, and the most a client may ask for
+const int CHANGES_PAGE_SIZE = 500;
+const int MAX_CHANGES_PAGE_SIZE = 5000;
+// Most mutations accepted in one /sync batch; a client with more queued
+// sends them over several requests
+const size_t MAX_SYNC_BATCH = 500;
+// Snapshots of the databases go to BACKUP_DIR/<YYYYMMDD-HHMMSS>/, one
+// per interval (EXPENSE_BACKUP_INTERVAL_MINUTES overrides it, 0 turns the
+// schedule off), keeping the newest BACKUP_KEEP
+const char* const BACKUP_DIR = "backups";
+const int BACKUP_INTERVAL_MINUTES = 6 * 60;
+const size_t BACKUP_KEEP = 8;
+// Months more than this many months before the current one are moved to
+// Archive.db at startup (EXPENSE_ARCHIVE_AFTER_MONTHS overrides it, 0 turns
+// archiving off)
+const int ARCHIVE_AFTER_MONTHS = 12;
+// Statements at least this slow are logged to slow_queries.log with their plan
+const double SLOW_QUERY_MS = 50.0;
+// Frontend files served by the binary itself; the build points this at the
+// source tree, EXPENSE_FRONTEND_DIR in the environment overrides it
+#ifndef EXPENSE_FRONTEND_DIR
+#define EXPENSE_FRONTEND_DIR "frontend"
+#endif
+
+StaticAssets frontend_assets;
 
 std::map<std::string, std::pair<int, time_t>> sessions;
 std::mutex sessions_mutex;
@@ -118,9 +257,21 @@ int get_session_user_id(const crow::request& req) {
     return it->second.first;
 }
 
+// PRAGMA user_version of an up-to-date auth.db; see MAIN_SCHEMA_VERSION in
+// FinanceDB.cpp
+const int AUTH_SCHEMA_VERSION = 1;
+
 bool init_auth_database() {
+    sqlite3_stmt* stmt;
+    int version = 0;
+    if (sqlite3_prepare_v2(auth_db, "PRAGMA user_version;", -1, &stmt, 0) == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW) {
+        version = sqlite3_column_int(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    if (version >= AUTH_SCHEMA_VERSION) return true;
+
     char* err_msg = nullptr;
-    const char* sql = "CREATE TABLE IF NOT EXISTS users ("
+    std::string sql = "CREATE TABLE IF NOT EXISTS users ("
                       "id INTEGER PRIMARY KEY AUTOINCREMENT,"
                       "username TEXT UNIQUE NOT NULL,"
                       "password_hash TEXT NOT NULL"
@@ -145,10 +296,11 @@ bool init_auth_database() {
                       "condition TEXT,"
                       "UNIQUE(user_id, month_year),"
                       "FOREIGN KEY(user_id) REFERENCES users(id)"
-                      ");";
-    int rc = sqlite3_exec(auth_db, sql, nullptr, nullptr, &err_msg);
+                      ");"
+                      "PRAGMA user_version = " + std::to_string(AUTH_SCHEMA_VERSION) + ";";
+    int rc = sqlite3_exec(auth_db, sql.c_str(), nullptr, nullptr, &err_msg);
     if (rc != SQLITE_OK) { 
-        std::cerr << "Auth DB Error: " << err_msg << std::endl; 
+        logError("Auth DB Error").field("error", err_msg);
         sqlite3_free(err_msg); 
         return false; 
     }
@@ -194,32 +346,522 @@ std::string getCurrentMonthYearStr() {
     return std::string(buffer);
 }
 
-int main() {
-  if (sodium_init() < 0) {
-    std::cerr << "Failed to initialize libsodium" << std::endl;
-    return 1;
-  }
-  if (sqlite3_open("auth.db", &auth_db) != SQLITE_OK) {
-    std::cerr << "Failed to open auth database" << std::endl;
-    return 1;
-  }
-  if (!init_auth_database()) {
-    std::cerr << "Failed to initialize auth database" << std::endl;
-    return 1;
-  }
+// Serializes expense rows, decoding category and mode of payment ids through
+// the cached dictionaries
+crow::json::wvalue expense_to_json(const ExpenseRecord& expense, const RefDataSnapshot& categories, const RefDataSnapshot& modes) {
+    crow::json::wvalue json;
+    json["id"] = expense.id;
+    json["day_month_year"] = expense.day_month_year;
+    json["spent_on"] = expense.spent_on;
+    json["price"] = expense.price;
+    json["category"] = categories.name(expense.category_id);
+    json["mode_of_payment"] = modes.name(expense.mode_of_payment_id);
+    json["priority"] = expense.priority;
+    return json;
+}
+
+crow::json::wvalue expenses_to_json(const std::vector<ExpenseRecord>& expenses, const FinanceDB& db) {
+    auto categories = db.getCategoriesSnapshot();
+    auto modes = db.getModeOfPaymentSnapshot();
+    crow::json::wvalue response;
+    for (size_t i = 0; i < expenses.size(); ++i) {
+        response[i] = expense_to_json(expenses[i], *categories, *modes);
+    }
+    return response;
+}
+
+std::string lookup_username(int user_id) {
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(auth_db, "SELECT username FROM users WHERE id = ?", -1, &stmt, nullptr) != SQLITE_OK) return "";
+    sqlite3_bind_int(stmt, 1, user_id);
+    std::string username;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        username = (const char*)sqlite3_column_text(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return username;
+}
+
+crow::json::wvalue summaries_to_json(const std::vector<MonthlySummary>& summaries) {
+    crow::json::wvalue response;
+    for (size_t i = 0; i < summaries.size(); ++i) {
+      response[i]["month_year"] = summaries[i].month_year;
+      response[i]["salary"] = summaries[i].salary;
+      response[i]["limit"] = summaries[i].limit;
+      response[i]["saving_percentage"] = summaries[i].saving_percentage;
+      response[i]["condition"] = summaries[i].condition;
+    }
+    return response;
+}
+
+crow::json::wvalue priority_to_json(const std::vector<ExpenseRecord>& prioritizedExpenses) {
+    crow::json::wvalue response;
+    for (size_t i = 0; i < prioritizedExpenses.size(); ++i) {
+      response[i]["spent_on"] = prioritizedExpenses[i].spent_on;
+      response[i]["average_price"] = prioritizedExpenses[i].price;
+      response[i]["times_purchased"] = prioritizedExpenses[i].priority;
+    }
+    return response;
+}
+
+// Rolling-window spend with the burn rate derived from it. The daily limit
+// spreads the month's LimitAmount evenly; burn_ratio above 1 means the last
+// 30 days were spent faster than that.
+std::string spend_overview_to_json(const SpendOverview& spend) {
+    double dailyBurn7 = spend.last7Days / 7.0;
+    double dailyBurn30 = spend.last30Days / 30.0;
+    double dailyLimit = spend.limit / spend.daysInMonth;
+    std::ostringstream out;
+    out << "{\"last_7_days\": " << spend.last7Days << ", \"last_30_days\": " << spend.last30Days
+        << ", \"last_90_days\": " << spend.last90Days << ", \"daily_burn_7d\": " << dailyBurn7
+        << ", \"daily_burn_30d\": " << dailyBurn30 << ", \"month_to_date\": " << spend.monthToDate
+        << ", \"projected_month\": " << spend.monthToDate / spend.dayOfMonth * spend.daysInMonth
+        << ", \"limit\": " << spend.limit << ", \"daily_limit\": " << dailyLimit << ", \"burn_ratio\": ";
+    if (dailyLimit > 0) {
+        out << dailyBurn30 / dailyLimit;
+    } else {
+        out << "null";
+    }
+    out << "}";
+    return out.str();
+}
+
+crow::json::wvalue backup_stats_to_json(const BackupStats& stats) {
+    crow::json::wvalue json;
+    json["db"] = stats.name;
+    json["ok"] = stats.ok;
+    if (!stats.ok) json["error"] = stats.error;
+    json["pages"] = stats.pages;
+    json["bytes"] = stats.bytes;
+    json["steps"] = stats.steps;
+    json["ms"] = stats.seconds * 1000;
+    json["mib_per_s"] = stats.seconds > 0 ? stats.bytes / stats.seconds / (1 << 20) : 0.0;
+    json["stall_ms"] = stats.stallSeconds * 1000;
+    json["max_stall_ms"] = stats.maxStallSeconds * 1000;
+    return json;
+}
+
+// `expense --restore <snapshot>`: copies a snapshot (an id under BACKUP_DIR,
+// or a path) over the databases in the working directory. Run it with the
+// server stopped.
+int restore_snapshot(const std::string& snapshot) {
+    std::string dir = snapshot.find('/') == std::string::npos ? std::string(BACKUP_DIR) + "/" + snapshot : snapshot;
+    int restored = 0;
+    for (const char* file : {"Main.db", "Detailed.db", "Archive.db", "auth.db"}) {
+        std::string path = dir + "/" + file;
+        std::ifstream present(path);
+        if (!present) continue;
+        std::string error;
+        if (!restoreDatabase(path, file, error)) {
+            logError("Restore failed").field("file", path).field("error", error);
+            return 1;
+        }
+        logInfo("Restored").field("file", file).field("from", path);
+        restored++;
+    }
+    if (restored == 0) {
+        logError("No database files in snapshot").field("dir", dir);
+        return 1;
+    }
+    return 0;
+}
+
+crow::json::wvalue budget_alert_to_json(const BudgetAlert& alert) {
+    crow::json::wvalue json;
+    json["id"] = alert.id;
+    json["time"] = alert.time;
+    json["rule"] = alertRuleName(alert.rule);
+    json["subject"] = alert.subject;
+    json["level"] = alertLevelName(alert.level);
+    json["spent"] = alert.spent;
+    json["limit"] = alert.limit;
+    return json;
+}
+
+// Fields of a change feed event for one write: the row as /expenses lists
+// it (just the id for a delete) and the month's new total
+std::string expense_change_fields(const ExpenseChange& change, const FinanceDB& db) {
+    std::string fields = "\"month_year\": \"" + getCurrentMonthYearStr() + "\"";
+    if (change.kind == ChangeKind::Delete) {
+        fields += ", \"id\": " + std::to_string(change.record.id);
+    } else {
+        fields += ", \"expense\": " + expense_to_json(change.record, *db.getCategoriesSnapshot(), *db.getModeOfPaymentSnapshot()).dump();
+    }
+    crow::json::wvalue total;
+    total = change.monthTotal;
+    return fields + ", \"total_spent\": " + total.dump();
+}
+
+// MM_YYYY for a YYYYMM month
+std::string month_year_of(int month) {
+    // Sized for any int, so a corrupt month can't truncate the output
+    char monthYear[24];
+    std::snprintf(monthYear, sizeof(monthYear), "%02d_%04d", month % 100, month / 100);
+    return monthYear;
+}
+
+crow::json::wvalue change_log_entry_to_json(const ChangeLogEntry& entry, const RefDataSnapshot& categories, const RefDataSnapshot& modes) {
+    crow::json::wvalue json;
+    json["seq"] = entry.seq;
+    json["op"] = entry.op;
+    json["month_year"] = month_year_of(entry.month);
+    json["id"] = entry.record.id;
+    json["at"] = entry.at;
+    if (entry.op != "delete") {
+        json["expense"]["id"] = entry.record.id;
+        json["expense"]["day_month_year"] = entry.record.day_month_year;
+        json["expense"]["spent_on"] = entry.record.spent_on;
+        json["expense"]["price"] = entry.record.price;
+        json["expense"]["category"] = categories.name(entry.record.category_id);
+        json["expense"]["mode_of_payment"] = modes.name(entry.record.mode_of_payment_id);
+    }
+    return json;
+}
+
+// An empty wvalue list dumps as null; embedded lists should stay arrays
+std::string dump_list(const crow::json::wvalue& list) {
+    std::string json = list.dump();
+    return json == "null" ? "[]" : json;
+}
+
+// The members of a change log page after "since", without braces: next,
+// latest, more and the changes themselves
+std::string change_page_fields(const ChangeLogPage& page, long long since, size_t limit, FinanceDB& db) {
+    auto categories = db.getCategoriesSnapshot();
+    auto modes = db.getModeOfPaymentSnapshot();
+    crow::json::wvalue changes;
+    for (size_t i = 0; i < page.entries.size(); ++i) {
+        changes[i] = change_log_entry_to_json(page.entries[i], *categories, *modes);
+    }
+    long long next = page.entries.empty() ? since : page.entries.back().seq;
+    return "\"next\": " + std::to_string(next) + ", \"latest\": " + std::to_string(page.latest) +
+           ", \"more\": " + (page.entries.size() == limit ? "true" : "false") + ", \"changes\": " + dump_list(changes);
+}
+
+// Reads one entry of a /sync batch. Returns what is wrong with it, empty if
+// nothing is.
+std::string parse_sync_mutation(const crow::json::rvalue& item, SyncMutation& mutation) {
+    using crow::json::type;
+    if (item.t() != type::Object) return "not an object";
+    if (!item.has("mutation_id") || item["mutation_id"].t() != type::String || item["mutation_id"].s().size() == 0) {
+        return "mutation_id is required";
+    }
+    mutation.mutationId = item["mutation_id"].s();
+
+    std::string op = item.has("op") && item["op"].t() == type::String ? std::string(item["op"].s()) : "";
+    if (op == "insert") {
+        mutation.kind = ChangeKind::Insert;
+    } else if (op == "update") {
+        mutation.kind = ChangeKind::Update;
+    } else if (op == "delete") {
+        mutation.kind = ChangeKind::Delete;
+    } else {
+        return "op must be insert, update or delete";
+    }
+    if (!item.has("ts") || item["ts"].t() != type::Number || item["ts"].i() < 0) {
+        return "ts must be the client's time in ms since the epoch";
+    }
+    mutation.ts = item["ts"].i();
+    if (mutation.kind != ChangeKind::Insert) {
+        if (!item.has("id") || item["id"].t() != type::Number) return "id is required";
+        mutation.id = static_cast<int>(item["id"].i());
+    }
+
+    if (item.has("fields")) {
+        if (item["fields"].t() != type::Object) return "fields must be an object";
+        for (const auto& field : item["fields"]) {
+            std::string key = field.key();
+            if (key == "price") {
+                if (field.t() != type::Number || !isNumber(field.d())) return "price must be a number";
+                mutation.price = field.d();
+                continue;
+            }
+            std::optional<std::string>* target = key == "spentOn"         ? &mutation.spentOn
+                                                 : key == "category"      ? &mutation.category
+                                                 : key == "modeOfPayment" ? &mutation.modeOfPayment
+                                                 : key == "date"          ? &mutation.date
+                                                                          : nullptr;
+            if (!target) return "unknown field " + key;
+            if (field.t() != type::String) return key + " must be a string";
+            *target = refinedString(field.s());
+        }
+    }
+    bool hasFields = mutation.spentOn || mutation.price || mutation.category || mutation.modeOfPayment || mutation.date;
+    if (mutation.kind == ChangeKind::Insert && (!mutation.spentOn || !mutation.price)) return "insert needs spentOn and price";
+    if (mutation.kind == ChangeKind::Update && !hasFields) return "update has no fields";
+    return "";
+}
+
+// MM_YYYY, the suffix of a month table name
+bool is_month_year(const std::string& value) {
+    return value.size() == 7 && value[2] == '_' &&
+           std::all_of(value.begin(), value.end(), [](char c) { return c == '_' || std::isdigit(static_cast<unsigned char>(c)); });
+}
+
+// Reads an optional ?limit=<n> (1..max); leaves `limit` alone when absent
+bool parse_limit(const crow::request& req, size_t& limit, long max = MAX_TOP_K) {
+    const char* param = req.url_params.get("limit");
+    if (!param) return true;
+    char* end = nullptr;
+    long value = std::strtol(param, &end, 10);
+    if (*param == '\0' || *end != '\0' || value < 1 || value > max) return false;
+    limit = static_cast<size_t>(value);
+    return true;
+}
+
+// If-None-Match carries "*" or a comma-separated list of entity tags, each
+// possibly weak (W/"..."). Matching is the weak comparison RFC 9110 asks for:
+// any listed tag equal to one of ours, W/ prefix ignored.
+bool if_none_match(const std::string& header, const std::string& etag, const std::string& baseEtag) {
+    size_t pos = 0;
+    while (pos < header.size()) {
+        size_t end = header.find(',', pos);
+        if (end == std::string::npos) end = header.size();
+        size_t first = header.find_first_not_of(" \t", pos);
+        size_t last = header.find_last_not_of(" \t", end - 1);
+        if (first != std::string::npos && first < end && last >= first) {
+            std::string tag = header.substr(first, last - first + 1);
+            if (tag == "*") return true;
+            if (tag.compare(0, 2, "W/") == 0) tag.erase(0, 2);
+            if (tag == etag || tag == baseEtag) return true;
+        }
+        pos = end + 1;
+    }
+    return false;
+}
+
+// Serves a cached reference list, answering 304 when the client already holds
+// the current version. Compressed forms come precomputed from the snapshot
+// and carry their own ETag ("<hash>-gzip").
+crow::response ref_data_response(const crow::request& req, const RefDataSnapshot& snapshot) {
+    ContentEncoding encoding = negotiateEncoding(req.get_header_value("Accept-Encoding"));
+    const std::string* encoded = snapshot.encodedJson->get(encoding);
+    std::string etag = encoded ? snapshot.etag.substr(0, snapshot.etag.size() - 1) + "-" + encodingName(encoding) + "\"" : snapshot.etag;
+
+    crow::response res;
+    res.set_header("ETag", etag);
+    res.set_header("Cache-Control", "private, no-cache");
+    res.set_header("Vary", "Accept-Encoding");
+    if (if_none_match(req.get_header_value("If-None-Match"), etag, snapshot.etag)) {
+        res.code = 304;
+        return res;
+    }
+    res.set_header("Content-Type", "application/json");
+    if (encoded) {
+        res.set_header("Content-Encoding", encodingName(encoding));
+        res.body = *encoded;
+    } else {
+        res.body = snapshot.json;
+    }
+    return res;
+}
+
+// Serves a frontend file from memory. Pages are revalidated on every load
+// (a 304 costs one round trip and no body); a URL carrying the file's version
+// (?v=<version>) can never change, so it is cached as immutable.
+crow::response static_asset_response(const crow::request& req, const StaticAsset& asset) {
+    ContentEncoding encoding = negotiateEncoding(req.get_header_value("Accept-Encoding"));
+    const std::string* encoded = asset.body->get(encoding);
+    std::string etag = encoded ? asset.etag.substr(0, asset.etag.size() - 1) + "-" + encodingName(encoding) + "\"" : asset.etag;
+
+    crow::response res;
+    res.set_header("ETag", etag);
+    const char* version = req.url_params.get("v");
+    res.set_header("Cache-Control", version && asset.version == version ? "public, max-age=31536000, immutable" : "no-cache");
+    res.set_header("Vary", "Accept-Encoding");
+    if (if_none_match(req.get_header_value("If-None-Match"), etag, asset.etag)) {
+        res.code = 304;
+        return res;
+    }
+    res.set_header("Content-Type", asset.contentType);
+    if (encoded) {
+        res.set_header("Content-Encoding", encodingName(encoding));
+        res.body = *encoded;
+    } else {
+        res.body = asset.body->identity();
+    }
+    return res;
+}
+
+int main(int argc, char* argv[]) {
+  if (argc == 3 && std::string(argv[1]) == "--restore") return restore_snapshot(argv[2]);
+
+  // auth.db, the frontend files and the finance databases don't depend on
+  // each other, so they are brought up in parallel
+  auto authReady = std::async(std::launch::async, [] {
+    if (sodium_init() < 0) {
+      logError("Failed to initialize libsodium");
+      return false;
+    }
+    if (sqlite3_open("auth.db", &auth_db) != SQLITE_OK) {
+      logError("Failed to open auth database");
+      return false;
+    }
+    if (!init_auth_database()) {
+      logError("Failed to initialize auth database");
+      return false;
+    }
+    return true;
+  });
+  auto assetsLoaded = std::async(std::launch::async, [] {
+    const char* frontendDir = std::getenv("EXPENSE_FRONTEND_DIR");
+    if (frontend_assets.load(frontendDir ? frontendDir : EXPENSE_FRONTEND_DIR) > 0) {
+      frontend_assets.alias("/", "/index.html");
+      frontend_assets.alias("/login", "/login.html");
+      frontend_assets.alias("/register", "/register.html");
+    }
+  });
 
   auto db_ptr = std::make_shared<FinanceDB>("Main.db", "Detailed.db");
+  db_ptr->enableQueryProfiler(SLOW_QUERY_MS, "slow_queries.log");
+
+  // Writes and budget alerts are pushed to open dashboards as small deltas
+  // over /changes, so they don't have to re-download lists after each edit
+  ChangeFeed change_feed;
+  db_ptr->setChangeListener([&change_feed, &db_ptr](const ExpenseChange& change) {
+    static const char* const TYPES[] = {"insert", "update", "delete"};
+    change_feed.publish(TYPES[static_cast<int>(change.kind)], expense_change_fields(change, *db_ptr));
+  });
+  db_ptr->budgetAlerts().subscribe([&change_feed](const BudgetAlert& alert) {
+    change_feed.publish("alert", "\"alert\": " + budget_alert_to_json(alert).dump());
+  });
+  assetsLoaded.get();
+  if (!authReady.get()) return 1;
+
+  BackupScheduler backups(BACKUP_DIR, BACKUP_KEEP, [&db_ptr](const std::string& dir) {
+    std::vector<BackupStats> stats = db_ptr->backupTo(dir);
+    stats.push_back(backupDatabase(auth_db, dir + "/auth.db", "auth.db"));
+    return stats;
+  });
+  logInfo("Databases open").field("ms_since_start", ms_since_start());
+  const char* archiveAfter = std::getenv("EXPENSE_ARCHIVE_AFTER_MONTHS");
+  int archive_after_months = archiveAfter ? std::atoi(archiveAfter) : ARCHIVE_AFTER_MONTHS;
+
+  Metrics::describe("http_requests_total", "HTTP requests by method, route and status code.");
+  Metrics::describe("http_request_duration_seconds", "HTTP request latency by method and route.");
+  Metrics::describe("sqlite_prepare_duration_seconds", "Time spent in sqlite3_prepare_v2 per database.");
+  Metrics::describe("sqlite_statement_duration_seconds", "Run time of each SQLite statement per database.");
+  Metrics::describe("graph_render_duration_seconds", "Time gnuplot takes to render a yearly graph.");
+  Metrics::describe("backup_step_duration_seconds", "Time one sqlite3_backup_step holds the source database, per database.");
+  Metrics::describe("backup_bytes_total", "Bytes copied into backups, per database.");
+  Metrics::describe("backup_snapshots_total", "Snapshots taken, by result.");
+  Metrics::gauge("change_feed_subscribers", "Open /changes/live WebSocket connections.", [&change_feed] {
+      return static_cast<double>(change_feed.subscriberCount());
+  });
+  Metrics::gauge("sqlite_read_connections_busy", "Pooled read-only Detailed.db connections leased to a query.", [&db_ptr] {
+      return static_cast<double>(db_ptr->readPool().busy());
+  });
+  Metrics::gauge("sessions_active", "Sessions currently held in memory, including expired ones not yet evicted.", [] {
+      std::lock_guard<std::mutex> lock(sessions_mutex);
+      return static_cast<double>(sessions.size());
+  });
 
-  crow::App<crow::CORSHandler, AuthMiddleware> app;
+  crow::App<MetricsMiddleware, CompressionMiddleware, crow::CORSHandler, AuthMiddleware> app;
+  // Crow's per-request Info lines are replaced by MetricsMiddleware's access log
+  crow::logger::setHandler(&crow_log_handler);
+  app.loglevel(crow::LogLevel::Warning);
+  app.timeout(KEEP_ALIVE_TIMEOUT_SECONDS);
+  crow::connection_limits& limits = app.limits();
+  limits.backlog = LISTEN_BACKLOG;
+  limits.tcp_nodelay = true;
+  limits.max_connections = MAX_CONNECTIONS;
+  limits.max_requests_per_connection = MAX_REQUESTS_PER_CONNECTION;
+  Metrics::gauge("http_connections_active", "Open client connections.", [&limits] { return static_cast<double>(limits.active.load()); });
+  Metrics::sampledCounter("http_connections_accepted_total", "Connections accepted.", [&limits] { return static_cast<double>(limits.accepted.load()); });
+  Metrics::sampledCounter("http_connections_rejected_total", "Connections closed on accept because MAX_CONNECTIONS were open.", [&limits] { return static_cast<double>(limits.rejected.load()); });
+  Metrics::sampledCounter("http_connections_request_limit_total", "Keep-alive connections closed after MAX_REQUESTS_PER_CONNECTION requests.", [&limits] { return static_cast<double>(limits.limit_closes.load()); });
   
   app.get_middleware<crow::CORSHandler>().global().allow_credentials();
 
-  CROW_ROUTE(app, "/")([]{ return "<p>Expense Tracker API</p>"
-         "<div><a href='/summary'>View All Summaries</a></div>"
-         "<div><a href='/expenses/08_2025'>View Expenses for August 2025 (example)</a></div>"
-         "<div><a href='/register'>Register</a></div>"
-         "<div><a href='/login'>Login</a></div>"
-         "<div><a href='http://localhost:8088'>Go to Frontend App</a></div>"; });
+  // One GET rule per frontend file; /login and /register keep their POST
+  // handlers below
+  for (const std::string& path : frontend_assets.paths()) {
+    const StaticAsset* asset = frontend_assets.find(path);
+    app.route_dynamic(path).methods(crow::HTTPMethod::Get)([asset](const crow::request& req) {
+      return static_asset_response(req, *asset);
+    });
+  }
+
+  CROW_ROUTE(app, "/metrics").methods(crow::HTTPMethod::Get)([] {
+      crow::response res(Metrics::render());
+      res.set_header("Content-Type", "text/plain; version=0.0.4");
+      return res;
+  });
+
+  // Per-statement profile of FinanceDB (DELETE clears it)
+  CROW_ROUTE(app, "/admin/queries").methods(crow::HTTPMethod::Get, crow::HTTPMethod::Delete)([&app, &db_ptr](const crow::request& req) {
+      if (app.get_context<AuthMiddleware>(req).user_id < 0) return crow::response(401, "{\"error\": \"Unauthorized\"}");
+      if (req.method == crow::HTTPMethod::Delete) {
+          db_ptr->resetQueryProfile();
+          return crow::response(200, "Query profile cleared.");
+      }
+      crow::response res(db_ptr->queryProfileJson());
+      res.set_header("Content-Type", "application/json");
+      return res;
+  });
+
+  // Online snapshots: GET lists them with the stats of the latest run, POST
+  // takes one now
+  CROW_ROUTE(app, "/admin/backups").methods(crow::HTTPMethod::Get, crow::HTTPMethod::Post)([&app, &backups](const crow::request& req) {
+      if (app.get_context<AuthMiddleware>(req).user_id < 0) return crow::response(401, "{\"error\": \"Unauthorized\"}");
+      if (req.method == crow::HTTPMethod::Post && backups.snapshotNow().empty()) {
+          crow::response res(500, "{\"error\": \"Snapshot failed; see the server log.\"}");
+          res.set_header("Content-Type", "application/json");
+          return res;
+      }
+      crow::json::wvalue json;
+      json["dir"] = backups.root();
+      crow::json::wvalue::list snapshots;
+      for (const auto& snapshot : backups.list()) {
+          crow::json::wvalue item;
+          item["id"] = snapshot.id;
+          item["bytes"] = snapshot.bytes;
+          snapshots.push_back(std::move(item));
+      }
+      json["snapshots"] = std::move(snapshots);
+      auto last = backups.lastRun();
+      json["last"]["id"] = last.first;
+      crow::json::wvalue::list files;
+      for (const auto& stats : last.second) files.push_back(backup_stats_to_json(stats));
+      json["last"]["files"] = std::move(files);
+      crow::response res(json.dump());
+      res.set_header("Content-Type", "application/json");
+      return res;
+  });
+
+  // Archived months with their rollups; POST runs the archiving now
+  CROW_ROUTE(app, "/admin/archive").methods(crow::HTTPMethod::Get, crow::HTTPMethod::Post)([&app, &db_ptr, archive_after_months](const crow::request& req) {
+      if (app.get_context<AuthMiddleware>(req).user_id < 0) return crow::response(401, "{\"error\": \"Unauthorized\"}");
+      crow::json::wvalue json;
+      if (req.method == crow::HTTPMethod::Post) {
+          if (archive_after_months < 1) return crow::response(409, "{\"error\": \"Archiving is turned off.\"}");
+          ArchiveResult run = db_ptr->archiveOldMonths(archive_after_months);
+          if (!run.ok) {
+              crow::response res(500, "{\"error\": \"Archiving failed for some months; see the server log.\"}");
+              res.set_header("Content-Type", "application/json");
+              return res;
+          }
+          crow::json::wvalue::list moved;
+          for (int month : run.months) moved.push_back(month_year_of(month));
+          json["run"]["months"] = std::move(moved);
+          json["run"]["rows"] = run.rows;
+          json["run"]["vacuumed"] = run.vacuumed;
+      }
+      json["after_months"] = archive_after_months;
+      crow::json::wvalue::list months;
+      for (const auto& month : db_ptr->getArchivedMonths()) {
+          crow::json::wvalue item;
+          item["month_year"] = month_year_of(month.month);
+          item["rows"] = month.rows;
+          item["total"] = month.total;
+          item["archived_at"] = month.archivedAt;
+          months.push_back(std::move(item));
+      }
+      json["months"] = std::move(months);
+      crow::response res(json.dump());
+      res.set_header("Content-Type", "application/json");
+      return res;
+  });
 
   CROW_ROUTE(app, "/register").methods(crow::HTTPMethod::Post)([](const crow::request& req) {
       auto b = crow::json::load(req.body);
@@ -280,50 +922,69 @@ int main() {
         return crow::response(401, "{\"error\": \"Unauthorized\"}");
       }
       
-      sqlite3_stmt* stmt;
-      if (sqlite3_prepare_v2(auth_db, "SELECT username FROM users WHERE id = ?", -1, &stmt, nullptr) != SQLITE_OK) {
-        return crow::response(500, "{\"error\": \"Database error\"}");
-      }
-      sqlite3_bind_int(stmt, 1, user_id);
-      std::string username;
-      if (sqlite3_step(stmt) == SQLITE_ROW) {
-        username = (const char*)sqlite3_column_text(stmt, 0);
-      }
-      sqlite3_finalize(stmt);
-      
-      return crow::response(200, "{\"user_id\": " + std::to_string(user_id) + ", \"username\": \"" + username + "\"}");
+      std::string username = lookup_username(user_id);
+      return crow::response(200, "{\"user_id\": " + std::to_string(user_id) + ", \"username\": \"" + jsonEscape(username) + "\"}");
+  });
+
+  // Everything the frontend needs on page load in one response: the user,
+  // both reference lists, the month's expenses, all summaries, the priority
+  // list and the total. Main.db and auth.db work runs on a second thread
+  // while the Detailed.db queries run here.
+  CROW_ROUTE(app, "/dashboard").methods(crow::HTTPMethod::Get)([&app, &db_ptr, &change_feed](const crow::request& req) {
+    int user_id = app.get_context<AuthMiddleware>(req).user_id;
+    if (user_id < 0) return crow::response(401, "{\"error\": \"Unauthorized\"}");
+    const char* monthParam = req.url_params.get("month");
+    std::string month_year = monthParam ? monthParam : getCurrentMonthYearStr();
+    if (!is_month_year(month_year)) {
+      return crow::response(400, "Bad Request: month must be MM_YYYY.");
+    }
+
+    auto mainPart = std::async(std::launch::async, [&db_ptr, user_id] {
+      return std::make_pair(lookup_username(user_id), dump_list(summaries_to_json(db_ptr->getAllSummaries())));
+    });
+    // Taken before the reads so a change racing them is replayed, not lost
+    uint64_t feedSeq = change_feed.lastSeq();
+    long long logSeq = db_ptr->latestChangeSeq();
+    auto categories = db_ptr->getCategoriesSnapshot();
+    auto modes = db_ptr->getModeOfPaymentSnapshot();
+    std::string expenses = dump_list(expenses_to_json(db_ptr->getExpensesForMonth(month_year), *db_ptr));
+    std::string highest = dump_list(priority_to_json(db_ptr->calcPriority()));
+    SpendOverview spend = db_ptr->getSpendOverview();
+    crow::json::wvalue total;
+    total = spend.monthToDate;
+    auto userAndSummaries = mainPart.get();
+
+    std::string body;
+    body.reserve(256 + categories->json.size() + modes->json.size() + expenses.size() + highest.size() + userAndSummaries.second.size());
+    body += "{\"user\": {\"user_id\": " + std::to_string(user_id) + ", \"username\": \"" + jsonEscape(userAndSummaries.first) + "\"}";
+    body += ", \"month_year\": \"" + jsonEscape(month_year) + "\"";
+    body += ", \"categories\": " + categories->json;
+    body += ", \"mode_of_payment\": " + modes->json;
+    body += ", \"expenses\": " + expenses;
+    body += ", \"summaries\": " + userAndSummaries.second;
+    body += ", \"highest\": " + highest;
+    body += ", \"total_spent\": " + total.dump();
+    body += ", \"spend\": " + spend_overview_to_json(spend);
+    body += ", \"feed_seq\": " + std::to_string(feedSeq);
+    body += ", \"log_seq\": " + std::to_string(logSeq) + "}";
+
+    crow::response res(body);
+    res.set_header("Content-Type", "application/json");
+    res.set_header("Cache-Control", "private, no-cache");
+    return res;
   });
 
   CROW_ROUTE(app, "/summary").methods(crow::HTTPMethod::Get)([&db_ptr](const crow::request& req) {
     int user_id = get_session_user_id(req);
     if (user_id < 0) return crow::response(401, "{\"error\": \"Unauthorized\"}");
     
-    auto summaries = db_ptr->getAllSummaries();
-    crow::json::wvalue response;
-    for (size_t i = 0; i < summaries.size(); ++i) {
-      response[i]["month_year"] = summaries[i].month_year;
-      response[i]["salary"] = summaries[i].salary;
-      response[i]["limit"] = summaries[i].limit;
-      response[i]["saving_percentage"] = summaries[i].saving_percentage;
-      response[i]["condition"] = summaries[i].condition;
-    }
-    return crow::response(response);
+    return crow::response(summaries_to_json(db_ptr->getAllSummaries()));
   });
 
   CROW_ROUTE(app, "/expenses/<string>")
       .methods(crow::HTTPMethod::Get)([&db_ptr](const std::string &month_year) {
         auto expenses = db_ptr->getExpensesForMonth(month_year);
-        crow::json::wvalue response;
-        for (size_t i = 0; i < expenses.size(); ++i) {
-          response[i]["id"] = expenses[i].id;
-          response[i]["day_month_year"] = expenses[i].day_month_year;
-          response[i]["spent_on"] = expenses[i].spent_on;
-          response[i]["price"] = expenses[i].price;
-          response[i]["category"] = expenses[i].category;
-          response[i]["mode_of_payment"] = expenses[i].mode_of_payment;
-          response[i]["priority"] = expenses[i].priority;
-        }
-        return crow::response(response);
+        return crow::response(expenses_to_json(expenses, *db_ptr));
       });
 
   CROW_ROUTE(app, "/summary")
@@ -395,28 +1056,37 @@ int main() {
           db_ptr->addOrUpdateMonthlySummary(current_summary.salary,
                                             current_summary.limit);
         } else {
-          std::cout << "Expense added, but summary not updated because salary "
-                       "is not set for the month."
-                    << std::endl;
+          logDebug("Expense added, but summary not updated because salary is not set for the month.")
+              .field("route", "/expense");
         }
 
         return crow::response(200, "Expense added successfully.");
       });
 
   CROW_ROUTE(app, "/highest").methods(crow::HTTPMethod::Get)([&db_ptr]() {
-    auto prioritizedExpenses = db_ptr->calcPriority();
-    crow::json::wvalue response;
-    for (size_t i = 0; i < prioritizedExpenses.size(); ++i) {
-      response[i]["spent_on"] = prioritizedExpenses[i].spent_on;
-      response[i]["average_price"] =
-          prioritizedExpenses[i]
-              .price;
-      response[i]["times_purchased"] =
-          prioritizedExpenses[i].priority;
-    }
-    return crow::response(response);
+    return crow::response(priority_to_json(db_ptr->calcPriority()));
   });
 
+  CROW_ROUTE(app, "/items/<string>/stats")
+      .methods(crow::HTTPMethod::Get)([&db_ptr](const crow::request &req, const std::string &item) {
+        const char* from = req.url_params.get("from");
+        const char* to = req.url_params.get("to");
+        if ((from && !is_month_year(from)) || (to && !is_month_year(to))) {
+          return crow::response(400, "Bad Request: from and to must be MM_YYYY.");
+        }
+        ItemStats stats = db_ptr->getItemStats(item, from ? from : "", to ? to : "");
+        crow::json::wvalue response;
+        response["spent_on"] = stats.spent_on;
+        response["count"] = stats.count;
+        response["total"] = stats.total;
+        response["average_price"] = stats.count ? stats.total / stats.count : 0.0;
+        response["min_price"] = stats.min;
+        response["max_price"] = stats.max;
+        response["p50_price"] = stats.p50;
+        response["p90_price"] = stats.p90;
+        return crow::response(response);
+      });
+
   CROW_ROUTE(app, "/range/<string>/<string>")
       .methods(
           crow::HTTPMethod::Get)([&db_ptr](const std::string &start_date_str,
@@ -438,21 +1108,11 @@ int main() {
 
         auto rangedExpenses =
             db_ptr->getRangeOfDate(formatted_start_date, formatted_end_date);
-        crow::json::wvalue response;
-        for (size_t i = 0; i < rangedExpenses.size(); ++i) {
-          response[i]["id"] = rangedExpenses[i].id;
-          response[i]["day_month_year"] = rangedExpenses[i].day_month_year;
-          response[i]["spent_on"] = rangedExpenses[i].spent_on;
-          response[i]["price"] = rangedExpenses[i].price;
-          response[i]["category"] = rangedExpenses[i].category;
-          response[i]["mode_of_payment"] = rangedExpenses[i].mode_of_payment;
-          response[i]["priority"] = rangedExpenses[i].priority;
-        }
-        return crow::response(response);
+        return crow::response(expenses_to_json(rangedExpenses, *db_ptr));
       });
 
   CROW_ROUTE(app, "/sorted_by_price/<string>")
-      .methods(crow::HTTPMethod::Get)([&db_ptr](const std::string &order_str) {
+      .methods(crow::HTTPMethod::Get)([&db_ptr](const crow::request &req, const std::string &order_str) {
         bool increasing = true;
         if (order_str == "false") {
           increasing = false;
@@ -463,36 +1123,63 @@ int main() {
               "'false' for descending, or leave empty for ascending.");
         }
 
-        auto sortedExpenses = db_ptr->calcSortByPrice(increasing);
-        crow::json::wvalue response;
-        for (size_t i = 0; i < sortedExpenses.size(); ++i) {
-          response[i]["id"] = sortedExpenses[i].id;
-          response[i]["day_month_year"] = sortedExpenses[i].day_month_year;
-          response[i]["spent_on"] = sortedExpenses[i].spent_on;
-          response[i]["price"] = sortedExpenses[i].price;
-          response[i]["category"] = sortedExpenses[i].category;
-          response[i]["mode_of_payment"] = sortedExpenses[i].mode_of_payment;
-          response[i]["priority"] = sortedExpenses[i].priority;
+        size_t limit = 0;
+        if (!parse_limit(req, limit)) {
+          return crow::response(crow::status::BAD_REQUEST, "Invalid limit parameter.");
         }
-        return crow::response(response);
+        auto sortedExpenses = limit ? db_ptr->topByPrice(limit, !increasing) : db_ptr->calcSortByPrice(increasing);
+        return crow::response(expenses_to_json(sortedExpenses, *db_ptr));
       });
 
   CROW_ROUTE(app, "/sorted_by_price/")
-      .methods(crow::HTTPMethod::Get)([&db_ptr]() {
-        auto sortedExpenses = db_ptr->calcSortByPrice(true);
-        crow::json::wvalue response;
-        for (size_t i = 0; i < sortedExpenses.size(); ++i) {
-          response[i]["id"] = sortedExpenses[i].id;
-          response[i]["day_month_year"] = sortedExpenses[i].day_month_year;
-          response[i]["spent_on"] = sortedExpenses[i].spent_on;
-          response[i]["price"] = sortedExpenses[i].price;
-          response[i]["category"] = sortedExpenses[i].category;
-          response[i]["mode_of_payment"] = sortedExpenses[i].mode_of_payment;
-          response[i]["priority"] = sortedExpenses[i].priority;
+      .methods(crow::HTTPMethod::Get)([&db_ptr](const crow::request &req) {
+        size_t limit = 0;
+        if (!parse_limit(req, limit)) {
+          return crow::response(crow::status::BAD_REQUEST, "Invalid limit parameter.");
         }
-        return crow::response(response);
+        auto sortedExpenses = limit ? db_ptr->topByPrice(limit, false) : db_ptr->calcSortByPrice(true);
+        return crow::response(expenses_to_json(sortedExpenses, *db_ptr));
+      });
+
+  CROW_ROUTE(app, "/top/<int>")
+      .methods(crow::HTTPMethod::Get)([&db_ptr](const crow::request &req, int k) {
+        if (k < 1 || k > MAX_TOP_K) {
+          return crow::response(crow::status::BAD_REQUEST, "k must be between 1 and " + std::to_string(MAX_TOP_K) + ".");
+        }
+        const char* order = req.url_params.get("order");
+        bool cheapest = order && std::string(order) == "asc";
+        return crow::response(expenses_to_json(db_ptr->topByPrice(k, !cheapest), *db_ptr));
       });
 
+  CROW_ROUTE(app, "/percentiles").methods(crow::HTTPMethod::Get)([&db_ptr](const crow::request &req) {
+    const char* param = req.url_params.get("q");
+    std::string list = param ? param : "50,90,99";
+    std::vector<double> percents;
+    std::vector<double> quantiles;
+    std::stringstream ss(list);
+    for (std::string item; std::getline(ss, item, ',');) {
+      char* end = nullptr;
+      double p = std::strtod(item.c_str(), &end);
+      if (item.empty() || *end != '\0' || !(p > 0.0 && p <= 100.0)) {
+        return crow::response(crow::status::BAD_REQUEST, "q must be a comma-separated list of percentiles in (0, 100].");
+      }
+      percents.push_back(p);
+      quantiles.push_back(p / 100.0);
+    }
+
+    PriceDistribution distribution = db_ptr->priceQuantiles(quantiles);
+    std::ostringstream out;
+    out << "{\"month_year\": \"" << getCurrentMonthYearStr() << "\", \"count\": " << distribution.count << ", \"percentiles\": [";
+    for (size_t i = 0; i < distribution.prices.size(); ++i) {
+      if (i > 0) out << ", ";
+      out << "{\"p\": " << percents[i] << ", \"price\": " << distribution.prices[i] << "}";
+    }
+    out << "]}";
+    crow::response res(out.str());
+    res.set_header("Content-Type", "application/json");
+    return res;
+  });
+
   CROW_ROUTE(app, "/total_spent").methods(crow::HTTPMethod::Get)([&db_ptr]() {
     double totalSpentAmount = db_ptr->calcTotalSpent();
     crow::json::wvalue response;
@@ -500,14 +1187,198 @@ int main() {
     return crow::response(response);
   });
 
-  CROW_ROUTE(app, "/categories").methods(crow::HTTPMethod::Get)([&db_ptr]() {
-    auto categories = db_ptr->getAllCategories();
-    
-    crow::json::wvalue response;
-    for (size_t i = 0; i < categories.size(); ++i) {
-      response[i] = categories[i];
+  CROW_ROUTE(app, "/spend_windows").methods(crow::HTTPMethod::Get)([&db_ptr]() {
+    crow::response res(spend_overview_to_json(db_ptr->getSpendOverview()));
+    res.set_header("Content-Type", "application/json");
+    return res;
+  });
+
+  // Set (limit > 0) or remove (limit 0) the current month's limit for a category
+  CROW_ROUTE(app, "/category_limit").methods(crow::HTTPMethod::Post)([&db_ptr](const crow::request &req) {
+    auto data = crow::json::load(req.body);
+    if (!data || !data.has("category") || !data.has("limit") || data["limit"].t() != crow::json::type::Number) {
+      return crow::response(400, "Bad Request: Missing 'category' or 'limit'.");
     }
-    return crow::response(response);
+    double limit = data["limit"].d();
+    if (limit < 0) {
+      return crow::response(400, "Bad Request: 'limit' must not be negative.");
+    }
+    std::string category = refinedString(data["category"].s());
+    if (db_ptr->setCategoryLimit(category, limit)) {
+      return crow::response(200, "Category limit saved.");
+    }
+    return crow::response(500, "Failed to save category limit.");
+  });
+
+  CROW_ROUTE(app, "/category_limits").methods(crow::HTTPMethod::Get)([&db_ptr]() {
+    crow::json::wvalue list;
+    int i = 0;
+    for (const auto& limit : db_ptr->getCategoryLimits()) {
+      list[i]["category"] = limit.category;
+      list[i]["limit"] = limit.limit;
+      list[i]["spent"] = limit.spent;
+      ++i;
+    }
+    crow::response res(dump_list(list));
+    res.set_header("Content-Type", "application/json");
+    return res;
+  });
+
+  // Durable change log for incremental sync: page through with ?since=<next>
+  // until "more" is false. 410 means entries after `since` were dropped and
+  // the client has to reload everything, then continue from "latest".
+  CROW_ROUTE(app, "/changes").methods(crow::HTTPMethod::Get)([&app, &db_ptr](const crow::request &req) {
+    if (app.get_context<AuthMiddleware>(req).user_id < 0) return crow::response(401, "{\"error\": \"Unauthorized\"}");
+    long long since = 0;
+    if (const char* param = req.url_params.get("since")) {
+      char* end = nullptr;
+      since = std::strtoll(param, &end, 10);
+      if (*param == '\0' || *end != '\0' || since < 0) {
+        return crow::response(crow::status::BAD_REQUEST, "since must be a change log seq.");
+      }
+    }
+    size_t limit = CHANGES_PAGE_SIZE;
+    if (!parse_limit(req, limit, MAX_CHANGES_PAGE_SIZE)) {
+      return crow::response(crow::status::BAD_REQUEST, "limit must be between 1 and " + std::to_string(MAX_CHANGES_PAGE_SIZE) + ".");
+    }
+
+    ChangeLogPage page = db_ptr->getChangesSince(since, limit);
+    if (page.truncated) {
+      crow::response res(410, "{\"error\": \"Changes after since were compacted away; reload and continue from latest.\", \"latest\": " +
+                                  std::to_string(page.latest) + "}");
+      res.set_header("Content-Type", "application/json");
+      return res;
+    }
+    crow::response res("{\"since\": " + std::to_string(since) + ", " + change_page_fields(page, since, limit, *db_ptr) + "}");
+    res.set_header("Content-Type", "application/json");
+    res.set_header("Cache-Control", "private, no-cache");
+    return res;
+  });
+
+  // Offline-first sync. A client sends the writes it queued while offline,
+  // tagged with its client_id, a mutation_id unique for that client and the
+  // time it made them, together with the change log seq it has caught up to.
+  // The batch is applied in one transaction, field conflicts going to the
+  // latest write, and answered with one result per mutation plus the first
+  // page of /changes after `since` (the client's own writes included).
+  // "resync": true stands for /changes' 410.
+  CROW_ROUTE(app, "/sync").methods(crow::HTTPMethod::POST)([&app, &db_ptr](const crow::request &req) {
+    if (app.get_context<AuthMiddleware>(req).user_id < 0) return crow::response(401, "{\"error\": \"Unauthorized\"}");
+    auto data = crow::json::load(req.body);
+    if (!data || !data.has("client_id") || data["client_id"].t() != crow::json::type::String ||
+        data["client_id"].s().size() == 0 || !data.has("mutations") || data["mutations"].t() != crow::json::type::List) {
+      return crow::response(400, "Bad Request: expected a client_id and a mutations list.");
+    }
+    long long since = 0;
+    if (data.has("since")) {
+      if (data["since"].t() != crow::json::type::Number || data["since"].i() < 0) {
+        return crow::response(400, "Bad Request: since must be a change log seq.");
+      }
+      since = data["since"].i();
+    }
+    if (data["mutations"].size() > MAX_SYNC_BATCH) {
+      return crow::response(400, "Bad Request: at most " + std::to_string(MAX_SYNC_BATCH) + " mutations per batch.");
+    }
+
+    // The whole batch is checked before any of it is applied
+    std::vector<SyncMutation> mutations;
+    for (const auto& item : data["mutations"]) {
+      SyncMutation mutation;
+      std::string error = parse_sync_mutation(item, mutation);
+      if (!error.empty()) {
+        return crow::response(400, "Bad Request: mutation " + std::to_string(mutations.size()) + ": " + error + ".");
+      }
+      mutations.push_back(std::move(mutation));
+    }
+
+    std::vector<SyncResult> results = db_ptr->applySync(data["client_id"].s(), mutations);
+    crow::json::wvalue resultsJson;
+    bool wrote = false;
+    for (size_t i = 0; i < results.size(); ++i) {
+      resultsJson[i]["mutation_id"] = results[i].mutationId;
+      resultsJson[i]["status"] = results[i].status;
+      resultsJson[i]["id"] = results[i].id;
+      crow::json::wvalue::list lost;
+      for (const auto& field : results[i].lostFields) lost.emplace_back(field);
+      resultsJson[i]["lost"] = std::move(lost);
+      wrote = wrote || results[i].status == "applied" || results[i].status == "partial";
+    }
+    if (wrote) {
+      auto current_summary = db_ptr->getCurrentMonthSummary();
+      if (current_summary.salary > 0) {
+        db_ptr->addOrUpdateMonthlySummary(current_summary.salary, current_summary.limit);
+      }
+    }
+
+    ChangeLogPage page = db_ptr->getChangesSince(since, CHANGES_PAGE_SIZE);
+    std::string body = "{\"results\": " + dump_list(resultsJson) + ", \"since\": " + std::to_string(since) + ", ";
+    if (page.truncated) {
+      body += "\"resync\": true, \"latest\": " + std::to_string(page.latest) + "}";
+    } else {
+      body += change_page_fields(page, since, CHANGES_PAGE_SIZE, *db_ptr) + "}";
+    }
+    crow::response res(body);
+    res.set_header("Content-Type", "application/json");
+    res.set_header("Cache-Control", "private, no-cache");
+    return res;
+  });
+
+  // Live change feed. The upgrade bypasses AuthMiddleware, so the session is
+  // checked here. ?since=<seq> first replays the retained events after seq.
+  // Its seqs count events of this server run and are unrelated to /changes.
+  struct FeedConnection {
+    uint64_t since = UINT64_MAX;
+    uint64_t handle = 0;
+  };
+  CROW_WEBSOCKET_ROUTE(app, "/changes/live")
+      .onaccept([](const crow::request& req, std::optional<crow::response>& res, void** userdata) {
+        if (get_session_user_id(req) < 0) {
+          res = crow::response(401, "{\"error\": \"Unauthorized\"}");
+          return;
+        }
+        auto feed = new FeedConnection;
+        if (const char* param = req.url_params.get("since")) {
+          char* end = nullptr;
+          unsigned long long since = std::strtoull(param, &end, 10);
+          if (*param != '\0' && *end == '\0') feed->since = since;
+        }
+        *userdata = feed;
+      })
+      .onopen([&change_feed](crow::websocket::connection& conn) {
+        auto feed = static_cast<FeedConnection*>(conn.userdata());
+        // send_text only queues onto the connection's strand, as publish requires
+        feed->handle = change_feed.subscribe([&conn](const std::string& event) { conn.send_text(event); }, feed->since);
+      })
+      .onclose([&change_feed](crow::websocket::connection& conn, const std::string&, uint16_t) {
+        auto feed = static_cast<FeedConnection*>(conn.userdata());
+        if (!feed) return;
+        change_feed.unsubscribe(feed->handle);
+        delete feed;
+        conn.userdata(nullptr);
+      });
+
+  // Alerts raised after ?since=<id> (all retained ones without it); poll with
+  // the last id seen
+  CROW_ROUTE(app, "/alerts").methods(crow::HTTPMethod::Get)([&db_ptr](const crow::request &req) {
+    uint64_t since = 0;
+    if (const char* param = req.url_params.get("since")) {
+      char* end = nullptr;
+      since = std::strtoull(param, &end, 10);
+      if (*param == '\0' || *end != '\0') {
+        return crow::response(crow::status::BAD_REQUEST, "since must be an alert id.");
+      }
+    }
+    crow::json::wvalue list;
+    int i = 0;
+    for (const auto& alert : db_ptr->budgetAlerts().since(since)) list[i++] = budget_alert_to_json(alert);
+    crow::response res(dump_list(list));
+    res.set_header("Content-Type", "application/json");
+    res.set_header("Cache-Control", "private, no-cache");
+    return res;
+  });
+
+  CROW_ROUTE(app, "/categories").methods(crow::HTTPMethod::Get)([&db_ptr](const crow::request &req) {
+    return ref_data_response(req, *db_ptr->getCategoriesSnapshot());
   });
 
   CROW_ROUTE(app, "/add_category").methods(crow::HTTPMethod::Post)([&db_ptr](const crow::request &req) {
@@ -522,14 +1393,8 @@ int main() {
     return crow::response(500, "Failed to add category.");
   });
 
-  CROW_ROUTE(app, "/mode_of_payment").methods(crow::HTTPMethod::Get)([&db_ptr]() {
-    auto modes = db_ptr->getAllModeOfPayment();
-    
-    crow::json::wvalue response;
-    for (size_t i = 0; i < modes.size(); ++i) {
-      response[i] = modes[i];
-    }
-    return crow::response(response);
+  CROW_ROUTE(app, "/mode_of_payment").methods(crow::HTTPMethod::Get)([&db_ptr](const crow::request &req) {
+    return ref_data_response(req, *db_ptr->getModeOfPaymentSnapshot());
   });
 
   CROW_ROUTE(app, "/add_mode_of_payment").methods(crow::HTTPMethod::Post)([&db_ptr](const crow::request &req) {
@@ -544,6 +1409,40 @@ int main() {
     return crow::response(500, "Failed to add mode of payment.");
   });
 
+  CROW_ROUTE(app, "/suggest").methods(crow::HTTPMethod::Get)([&db_ptr](const crow::request &req) {
+    const char* q = req.url_params.get("q");
+    std::string prefix = q ? q : "";
+    if (!prefix.empty()) {
+      prefix = refinedString(prefix);
+    }
+
+    SuggestKind kind = SuggestKind::Item;
+    const char* kindParam = req.url_params.get("kind");
+    std::string kindStr = kindParam ? kindParam : "item";
+    if (kindStr == "category") {
+      kind = SuggestKind::Category;
+    } else if (kindStr == "mode_of_payment") {
+      kind = SuggestKind::ModeOfPayment;
+    } else if (kindStr != "item") {
+      return crow::response(400, "Bad Request: 'kind' must be item, category or mode_of_payment.");
+    }
+
+    size_t limit = 10;
+    if (!parse_limit(req, limit, 50)) {
+      return crow::response(400, "Bad Request: 'limit' must be between 1 and 50.");
+    }
+
+    // A list even when nothing matches, so the client gets [] and not null
+    crow::json::wvalue::list response;
+    for (const auto& suggestion : db_ptr->suggest(kind, prefix, limit)) {
+      crow::json::wvalue item;
+      item["name"] = suggestion.name;
+      item["weight"] = suggestion.weight;
+      response.push_back(std::move(item));
+    }
+    return crow::response(crow::json::wvalue(std::move(response)));
+  });
+
   CROW_ROUTE(app, "/delete_expense/<int>").methods(crow::HTTPMethod::Delete)([&db_ptr](int id) {
     if (!isNumber(id)) {
       return crow::response(400, "Bad Request: ID must be a number.");
@@ -641,7 +1540,10 @@ int main() {
         canvas.title("Yearly Expense Report - " + std::to_string(year));
 
         std::string tempFile = "/tmp/yearly_expense_graph_" + std::to_string(year) + ".svg";
+        static const int renderMetric = Metrics::series(MetricType::Histogram, "graph_render_duration_seconds");
+        auto renderStart = std::chrono::steady_clock::now();
         canvas.save(tempFile);
+        Metrics::observe(renderMetric, std::chrono::duration<double>(std::chrono::steady_clock::now() - renderStart).count());
 
         std::ifstream file(tempFile);
         std::stringstream buffer;
@@ -682,7 +1584,10 @@ int main() {
         canvas.title("Yearly Expense Report - " + std::to_string(year));
 
         std::string tempFile = "/tmp/yearly_expense_graph_" + std::to_string(year) + ".svg";
+        static const int renderMetric = Metrics::series(MetricType::Histogram, "graph_render_duration_seconds");
+        auto renderStart = std::chrono::steady_clock::now();
         canvas.save(tempFile);
+        Metrics::observe(renderMetric, std::chrono::duration<double>(std::chrono::steady_clock::now() - renderStart).count());
 
         std::ifstream file(tempFile);
         std::stringstream buffer;
@@ -697,9 +1602,43 @@ int main() {
         return response;
       });
 
-  std::cout << "Starting server on port 5000..." << std::endl;
+  // Cache warm-up runs behind the listening server; /readyz turns 200 once
+  // it is done. Requests arriving earlier are answered from SQLite.
+  std::atomic<bool> caches_warm{false};
+  std::thread warmup([&db_ptr, &caches_warm, archive_after_months] {
+    db_ptr->enableAnalyticsSnapshot();
+    db_ptr->loadSuggestIndex();
+    db_ptr->compactChangeLog();
+    caches_warm = true;
+    logInfo("Caches warm").field("ms_since_start", ms_since_start());
+    // Last, since the VACUUM after a move holds up writes while it runs
+    if (archive_after_months > 0) db_ptr->archiveOldMonths(archive_after_months);
+  });
+  const char* backupInterval = std::getenv("EXPENSE_BACKUP_INTERVAL_MINUTES");
+  backups.start(std::chrono::minutes(backupInterval ? std::atoi(backupInterval) : BACKUP_INTERVAL_MINUTES));
+
+  CROW_ROUTE(app, "/healthz").methods(crow::HTTPMethod::Get)([] {
+    crow::response res(200, "{\"status\": \"ok\"}");
+    res.set_header("Content-Type", "application/json");
+    return res;
+  });
+
+  CROW_ROUTE(app, "/readyz").methods(crow::HTTPMethod::Get)([&db_ptr, &caches_warm] {
+    bool databases = db_ptr->isOpen();
+    bool caches = caches_warm;
+    crow::response res(databases && caches ? 200 : 503,
+                       std::string("{\"ready\": ") + (databases && caches ? "true" : "false") +
+                       ", \"databases\": " + (databases ? "true" : "false") +
+                       ", \"caches\": " + (caches ? "true" : "false") + "}");
+    res.set_header("Content-Type", "application/json");
+    return res;
+  });
+
+  logInfo("Starting server").field("port", 5000).field("ms_since_start", ms_since_start());
 
   app.port(5000).run();
 
+  backups.stop();
+  warmup.join();
   return 0;
 }
@@ -7202,6 +7202,8 @@ namespace crow // NOTE: Already documented in "crow/app.h"
         ci_map headers;
         std::string body;
         std::string remote_ip_address; ///< The IP address from which the request was sent.
+        std::string route;       ///< Template of the matched rule (e.g. `/expenses/<string>`), empty when none matched.
+        std::shared_ptr<void> connection_slot; ///< Held while the connection counts towards `connection_limits::active`; an upgraded connection keeps it.
         unsigned char http_ver_major, http_ver_minor;
         bool keep_alive,    ///< Whether or not the server should send a `connection: Keep-Alive` header to the client.
           close_connection, ///< Whether or not the server should shut down the TCP connection once a response is sent.
@@ -10684,6 +10686,21 @@ namespace crow
     static std::atomic<int> connectionCount;
 #endif
 
+    /// Connection-level tuning and counters shared by an app and its server.
+    /// (Local addition for the expense tracker; not part of upstream Crow.)
+    struct connection_limits
+    {
+        int backlog = static_cast<int>(asio::socket_base::max_listen_connections);
+        bool tcp_nodelay = false;
+        std::size_t max_connections = 0;             ///< 0 = unlimited
+        std::size_t max_requests_per_connection = 0; ///< 0 = unlimited
+
+        std::atomic<std::uint64_t> accepted{0};
+        std::atomic<std::uint64_t> rejected{0};
+        std::atomic<std::uint64_t> limit_closes{0}; ///< keep-alive ended by max_requests_per_connection
+        std::atomic<std::size_t> active{0};
+    };
+
     /// An HTTP connection.
     template<typename Adaptor, typename Handler, typename... Middlewares>
     class Connection : public std::enable_shared_from_this<Connection<Adaptor, Handler, Middlewares...>>
@@ -10727,6 +10744,16 @@ namespace crow
 #endif
         }
 
+        /// Counts this connection in `limits` and applies its per-connection request cap.
+        /// The count is released with the last holder of the slot, which is the
+        /// WebSocket connection once this one has been upgraded.
+        void track(connection_limits* limits)
+        {
+            limits_ = limits;
+            limits_->active++;
+            slot_ = std::shared_ptr<void>(nullptr, [limits](void*) { limits->active--; });
+        }
+
         /// The TCP socket on top of which the connection is established.
         decltype(std::declval<Adaptor>().raw_socket())& socket()
         {
@@ -10791,6 +10818,12 @@ namespace crow
             req_.remote_ip_address = adaptor_.address();
             add_keep_alive_ = req_.keep_alive;
             close_connection_ = req_.close_connection;
+            if (limits_ && limits_->max_requests_per_connection && ++requests_served_ >= limits_->max_requests_per_connection && !close_connection_)
+            {
+                limits_->limit_closes++;
+                add_keep_alive_ = false;
+                close_connection_ = true;
+            }
 
             if (req_.check_version(1, 1)) // HTTP/1.1
             {
@@ -10813,6 +10846,7 @@ namespace crow
                         detail::middleware_call_helper<detail::middleware_call_criteria_only_global,
                                                        0, decltype(ctx_), decltype(*middlewares_)>({}, *middlewares_, req_, res, ctx_);
                         close_connection_ = true;
+                        req_.connection_slot = slot_;
                         handler_->handle_upgrade(req_, res, std::move(adaptor_));
                         return;
                     }
@@ -10925,6 +10959,10 @@ namespace crow
                 //delete this;
                 return;
             }
+            if (limits_ && limits_->max_requests_per_connection && requests_served_ >= limits_->max_requests_per_connection)
+            {
+                res.set_header("Connection", "close");
+            }
             res.write_header_into_buffer(buffers_, content_length_, add_keep_alive_, server_name_);
         }
 
@@ -11162,6 +11200,9 @@ namespace crow
         size_t res_stream_threshold_;
 
         std::atomic<unsigned int>& queue_length_;
+        connection_limits* limits_ = nullptr;
+        std::shared_ptr<void> slot_;
+        std::size_t requests_served_ = 0;
     };
 
 } // namespace crow
@@ -11213,7 +11254,8 @@ namespace crow // NOTE: Already documented in "crow/app.h"
              std::tuple<Middlewares...>* middlewares = nullptr,
              unsigned int concurrency = 1,
              uint8_t timeout = 5,
-             typename Adaptor::context* adaptor_ctx = nullptr):
+             typename Adaptor::context* adaptor_ctx = nullptr,
+             connection_limits* limits = nullptr):
           concurrency_(concurrency),
           task_queue_length_pool_(concurrency_ - 1),
           acceptor_(io_context_),
@@ -11223,7 +11265,8 @@ namespace crow // NOTE: Already documented in "crow/app.h"
           timeout_(timeout),
           server_name_(server_name),
           middlewares_(middlewares),
-          adaptor_ctx_(adaptor_ctx)
+          adaptor_ctx_(adaptor_ctx),
+          limits_(limits)
         {
             if (startup_failed_) {
                 CROW_LOG_ERROR << "Startup failed; not running server.";
@@ -11254,7 +11297,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                 return;
             }
 
-            acceptor_.raw_acceptor().listen(tcp::acceptor::max_listen_connections, ec);
+            acceptor_.raw_acceptor().listen(limits_ ? limits_->backlog : static_cast<int>(tcp::acceptor::max_listen_connections), ec);
             if (ec) {
                 CROW_LOG_ERROR << "Failed to listen on port: " << ec.message();
                 startup_failed_ = true;
@@ -11478,6 +11521,24 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                 acceptor_.raw_acceptor().async_accept(
                   p->socket(),
                   [this, p, &ic](error_code ec) {
+                      if (!ec && limits_)
+                      {
+                          if (limits_->max_connections && limits_->active >= limits_->max_connections)
+                          {
+                              limits_->rejected++;
+                              error_code close_ec;
+                              p->socket().close(close_ec);
+                              do_accept();
+                              return;
+                          }
+                          limits_->accepted++;
+                          if (limits_->tcp_nodelay)
+                          {
+                              error_code opt_ec;
+                              p->socket().set_option(tcp::no_delay(true), opt_ec);
+                          }
+                          p->track(limits_);
+                      }
                       if (!ec)
                       {
                           asio::post(ic,
@@ -11526,6 +11587,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
         std::tuple<Middlewares...>* middlewares_;
 
         typename Adaptor::context* adaptor_ctx_;
+        connection_limits* limits_;
     };
 } // namespace crow
 
@@ -11654,6 +11716,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                                                                        std::move(close_handler),
                                                                        std::move(error_handler), 
                                                                        std::move(accept_handler)));
+                conn->connection_slot_ = req.connection_slot;
                 
                 // Perform handshake validation
                 if (!utility::string_equals(req.get_header_value("upgrade"), "websocket"))
@@ -12240,7 +12303,8 @@ namespace crow // NOTE: Already documented in "crow/app.h"
             /// Also destroys the object if the Close flag is set.
             void do_write()
             {
-                if (write_buffers_.empty()) return;
+                // A write is already in flight; its completion handler sends what was queued meanwhile
+                if (write_buffers_.empty() || !sending_buffers_.empty()) return;
 
                 sending_buffers_.swap(write_buffers_);
                 std::vector<asio::const_buffer> buffers;
@@ -12353,6 +12417,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
             uint64_t remaining_length_{0};
             uint64_t max_payload_bytes_{UINT64_MAX};
             std::string subprotocol_;
+            std::shared_ptr<void> connection_slot_; // keeps the upgraded socket counted in connection_limits
             bool close_connection_{false};
             bool is_reading{false};
             bool has_mask_{false};
@@ -13933,6 +13998,14 @@ namespace crow // NOTE: Already documented in "crow/app.h"
             return EMPTY;
         }
 
+        /// The URL template a rule was registered with, or "" for the special indices
+        std::string rule_template(HTTPMethod method, unsigned rule_index)
+        {
+            const auto& rules = per_methods_[static_cast<int>(method)].rules;
+            if (rule_index >= rules.size() || !rules[rule_index]) return {};
+            return rules[rule_index]->rule();
+        }
+
         std::unique_ptr<routing_handle_result> handle_initial(request& req, response& res)
         {
             HTTPMethod method_actual = req.method;
@@ -13966,6 +14039,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
 
                 res.skip_body = true;
                 found->method = method_actual;
+                req.route = rule_template(method_actual, found->rule_index);
                 return found;
             }
             else if (req.method == HTTPMethod::Options)
@@ -14059,6 +14133,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                 }
 
                 found->method = method_actual;
+                req.route = rule_template(method_actual, found->rule_index);
                 return found;
             }
         }
@@ -14778,6 +14853,14 @@ namespace crow
             return *this;
         }
 
+        /// \brief Connection-level tuning (accept backlog, TCP_NODELAY, connection and
+        /// per-connection request caps) and the counters the server keeps there.
+        /// Settings must be made before run().
+        connection_limits& limits()
+        {
+            return limits_;
+        }
+
         /// \brief Set the server name included in the 'Server' HTTP response header. If set to an empty string, the header will be omitted by default.
         self_t& server_name(std::string server_name)
         {
@@ -14981,7 +15064,7 @@ namespace crow
                 }
                 tcp::endpoint endpoint(addr, port_);
                 router_.using_ssl = true;
-                ssl_server_ = std::move(std::unique_ptr<ssl_server_t>(new ssl_server_t(this, endpoint, server_name_, &middlewares_, concurrency_, timeout_, &ssl_context_)));
+                ssl_server_ = std::move(std::unique_ptr<ssl_server_t>(new ssl_server_t(this, endpoint, server_name_, &middlewares_, concurrency_, timeout_, &ssl_context_, &limits_)));
                 ssl_server_->set_tick_function(tick_interval_, tick_function_);
                 ssl_server_->signal_clear();
                 for (auto snum : signals_)
@@ -14997,7 +15080,7 @@ namespace crow
                 if (use_unix_)
                 {
                     UnixSocketAcceptor::endpoint endpoint(bindaddr_);
-                    unix_server_ = std::move(std::unique_ptr<unix_server_t>(new unix_server_t(this, endpoint, server_name_, &middlewares_, concurrency_, timeout_, nullptr)));
+                    unix_server_ = std::move(std::unique_ptr<unix_server_t>(new unix_server_t(this, endpoint, server_name_, &middlewares_, concurrency_, timeout_, nullptr, &limits_)));
                     unix_server_->set_tick_function(tick_interval_, tick_function_);
                     for (auto snum : signals_)
                     {
@@ -15015,7 +15098,7 @@ namespace crow
                         return;
                     }
                     TCPAcceptor::endpoint endpoint(addr, port_);
-                    server_ = std::move(std::unique_ptr<server_t>(new server_t(this, endpoint, server_name_, &middlewares_, concurrency_, timeout_, nullptr)));
+                    server_ = std::move(std::unique_ptr<server_t>(new server_t(this, endpoint, server_name_, &middlewares_, concurrency_, timeout_, nullptr, &limits_)));
                     server_->set_tick_function(tick_interval_, tick_function_);
                     for (auto snum : signals_)
                     {
@@ -15249,6 +15332,7 @@ namespace crow
 
     private:
         std::uint8_t timeout_{5};
+        connection_limits limits_;
         uint16_t port_ = 80;
         unsigned int concurrency_ = 2;
         std::atomic_bool is_bound_ = false;